@@ -199,7 +199,7 @@ APEX_fetch(APEX_CPU *cpu)
         }
     }
 
-    if (ENABLE_DEBUG_MESSAGES && cpu->fetch.opcode != OPCODE_NULL)
+    if (ENABLE_DEBUG_MESSAGES && !cpu->quiet && cpu->fetch.opcode != OPCODE_NULL)
     {
         print_stage_content("Fetch", &cpu->fetch);
     }
@@ -405,7 +405,7 @@ APEX_decode(APEX_CPU *cpu)
         cpu->decode.has_insn = FALSE;
     }
 
-    if (ENABLE_DEBUG_MESSAGES && cpu->decode.opcode != OPCODE_NULL)
+    if (ENABLE_DEBUG_MESSAGES && !cpu->quiet && cpu->decode.opcode != OPCODE_NULL)
     {
         print_stage_content("Decode/RF", &cpu->decode);
     }
@@ -577,7 +577,7 @@ APEX_execute(APEX_CPU *cpu)
         /* Copy data from execute latch to memory latch*/
         cpu->memory = cpu->execute;
         cpu->execute.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->execute.opcode != OPCODE_NULL)
+        if (ENABLE_DEBUG_MESSAGES && !cpu->quiet && cpu->execute.opcode != OPCODE_NULL)
         {
             print_stage_content("Execute", &cpu->execute);
         }
@@ -664,7 +664,7 @@ APEX_memory(APEX_CPU *cpu)
         cpu->writeback = cpu->memory;
         cpu->memory.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->memory.opcode != OPCODE_NULL)
+        if (ENABLE_DEBUG_MESSAGES && !cpu->quiet && cpu->memory.opcode != OPCODE_NULL)
         {
             print_stage_content("Memory", &cpu->memory);
         }
@@ -723,10 +723,14 @@ APEX_writeback(APEX_CPU *cpu)
         }
         }
         cpu->decode.stalled = 0;
-        cpu->insn_completed++;
+        /* Bubbles left behind by a flush are not instructions */
+        if (cpu->writeback.opcode != OPCODE_NULL)
+        {
+            cpu->insn_completed++;
+        }
         cpu->writeback.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->writeback.opcode != OPCODE_NULL)
+        if (ENABLE_DEBUG_MESSAGES && !cpu->quiet && cpu->writeback.opcode != OPCODE_NULL)
         {
             print_stage_content("Writeback", &cpu->writeback);
         }
@@ -790,30 +794,37 @@ APEX_cpu_init(const char *filename)
         return NULL;
     }
 
-    if (ENABLE_DEBUG_MESSAGES)
-    {
-        fprintf(stderr,
-                "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
-                cpu->code_memory_size);
-        fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
-        fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
-        printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
-               "imm");
-
-        for (i = 0; i < cpu->code_memory_size; ++i)
-        {
-            printf("%-9s %-9d %-9d %-9d %-9d\n", cpu->code_memory[i].opcode_str,
-                   cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
-                   cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
-        }
-    }
-
     /* To start fetch stage */
     cpu->fetch.has_insn = TRUE;
 
     return cpu;
 }
 
+/*
+ * Prints the parsed code memory, done by the interactive front end right
+ * after the CPU is initialized
+ */
+void
+APEX_print_code_memory(const APEX_CPU *cpu)
+{
+    int i;
+
+    fprintf(stderr,
+            "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
+            cpu->code_memory_size);
+    fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
+    fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
+    printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
+           "imm");
+
+    for (i = 0; i < cpu->code_memory_size; ++i)
+    {
+        printf("%-9s %-9d %-9d %-9d %-9d\n", cpu->code_memory[i].opcode_str,
+               cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
+               cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
+    }
+}
+
 /*
  * APEX CPU simulation loop
  *
@@ -924,7 +935,7 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
 {
     int breaker = 0;
     char user_prompt_val;
-    if (ENABLE_DEBUG_MESSAGES)
+    if (ENABLE_DEBUG_MESSAGES && !cpu->quiet)
     {
         printf("--------------------------------------------\n");
         printf("Clock Cycle #: %d\n", cpu->clock + 1);
@@ -934,7 +945,11 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
     if (APEX_writeback(cpu))
     {
         /* Halt in writeback stage */
-        printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock + 1, cpu->insn_completed);
+        if (!cpu->quiet)
+        {
+            printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock + 1, cpu->insn_completed);
+        }
+        cpu->clock++;
         return 1;
     }
 
@@ -943,7 +958,10 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
     APEX_decode(cpu);
     APEX_fetch(cpu);
 
-    print_reg_file(cpu);
+    if (!cpu->quiet)
+    {
+        print_reg_file(cpu);
+    }
 
     if (cpu->single_step && z == 0)
     {
@@ -961,6 +979,46 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
     return breaker;
 }
 
+/*
+ * Headless run used by --run-to-halt. Steps the pipeline without prompting
+ * until HALT commits or max_cycles (0 = no limit) have elapsed. Returns
+ * TRUE if the program halted.
+ */
+int
+APEX_cpu_run_to_halt(APEX_CPU *cpu, long max_cycles)
+{
+    while (!APEX_run_at_choice(cpu, 1))
+    {
+        if (max_cycles > 0 && cpu->clock >= max_cycles)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Final summary printed after a headless run */
+void
+APEX_print_summary(const APEX_CPU *cpu)
+{
+    int i;
+
+    printf("APEX_CPU: cycles = %d instructions = %d IPC = %.3f\n", cpu->clock,
+           cpu->insn_completed,
+           cpu->clock ? (double)cpu->insn_completed / cpu->clock : 0.0);
+    for (i = 0; i < REG_FILE_SIZE; i++)
+    {
+        printf("R%d=%d%s", i, cpu->regs[i], i == REG_FILE_SIZE - 1 ? "\n" : " ");
+    }
+    for (i = 0; i < DATA_MEMORY_SIZE; i++)
+    {
+        if (cpu->data_memory[i] != 0)
+        {
+            printf("MEM[%d]=%d\n", i, cpu->data_memory[i]);
+        }
+    }
+}
+
 /*
  * This function deallocates APEX CPU.
  *
@@ -58,6 +58,7 @@ typedef struct APEX_CPU
     APEX_Instruction *code_memory;     /* Code Memory */
     int data_memory[DATA_MEMORY_SIZE]; /* Data Memory */
     int single_step;                   /* Wait for user input after every cycle */
+    int quiet;                         /* Suppress per-cycle output */
     int zero_flag;                     /* {TRUE, FALSE} Used by BZ and BNZ to branch */
     int fetch_from_next_cycle;
 
@@ -75,5 +76,8 @@ APEX_Instruction *create_code_memory(const char *filename, int *size);
 APEX_CPU *APEX_cpu_init(const char *filename);
 void APEX_cpu_run(APEX_CPU *cpu, int x, int y);
 int APEX_run_at_choice(APEX_CPU *cpu, int z);
+int APEX_cpu_run_to_halt(APEX_CPU *cpu, long max_cycles);
+void APEX_print_code_memory(const APEX_CPU *cpu);
+void APEX_print_summary(const APEX_CPU *cpu);
 void APEX_cpu_stop(APEX_CPU *cpu);
 #endif
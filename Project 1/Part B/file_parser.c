@@ -26,7 +26,7 @@ get_num_from_string(const char *buffer)
     char str[16];
     int i, j = 0;
 
-    for (i = 1; buffer[i] != '\0'; ++i)
+    for (i = 1; buffer[i] != '\0' && j < (int)sizeof(str) - 1; ++i)
     {
         str[j] = buffer[i];
         j++;
@@ -140,40 +140,41 @@ set_opcode_str(const char *opcode_str)
     return 0;
 }
 
-static void
-split_opcode_from_insn_string(char *buffer, char tokens[2][128])
+/*
+ * Copies the delims separated tokens of buffer into tokens. Returns FALSE
+ * if there are more than max_tokens or one does not fit.
+ */
+static int
+split_tokens(char *buffer, const char *delims, char tokens[][128], int max_tokens)
 {
     int token_num = 0;
-    char *p;
-    char *token = strtok(buffer, " ");
+    char *save;
+    char *token = strtok_r(buffer, delims, &save);
 
     while (token != NULL)
     {
-        strcpy(tokens[token_num], token);
-        token_num++;
-        token = strtok(NULL, " ");
-    }
-    p = tokens[0];
-    while(*p != '\0')
-    {
-        if (*p == '\n')
+        if (token_num == max_tokens ||
+            snprintf(tokens[token_num], sizeof(tokens[0]), "%s", token) >= (int)sizeof(tokens[0]))
         {
-        *p = '\0';
-        break;
+            return FALSE;
         }
-        p++;
+        token_num++;
+        token = strtok_r(NULL, delims, &save);
     }
+    return TRUE;
 }
 
 /*
- * This function is related to parsing input file
+ * This function is related to parsing input file. Returns FALSE if the
+ * line is not an opcode followed by at most one comma separated operand
+ * list, surrounding whitespace aside.
  *
  * Note : you can edit this function to add new instructions
  */
-static void
+static int
 create_APEX_instruction(APEX_Instruction *ins, char *buffer)
 {
-    int i, token_num = 0;
+    int i;
     char tokens[6][128];
     char top_level_tokens[2][128];
 
@@ -182,15 +183,10 @@ create_APEX_instruction(APEX_Instruction *ins, char *buffer)
         strcpy(top_level_tokens[i], "");
     }
 
-    split_opcode_from_insn_string(buffer, top_level_tokens);
-
-    char *token = strtok(top_level_tokens[1], ",");
-
-    while (token != NULL)
+    if (!split_tokens(buffer, " \t\r\n", top_level_tokens, 2) ||
+        !split_tokens(top_level_tokens[1], ",", tokens, 6))
     {
-        strcpy(tokens[token_num], token);
-        token_num++;
-        token = strtok(NULL, ",");
+        return FALSE;
     }
 
     strcpy(ins->opcode_str, top_level_tokens[0]);
@@ -260,6 +256,7 @@ create_APEX_instruction(APEX_Instruction *ins, char *buffer)
     }
     }
     /* Fill in rest of the instructions accordingly */
+    return TRUE;
 }
 
 /*
@@ -310,7 +307,15 @@ create_code_memory(const char *filename, int *size)
     rewind(fp);
     while ((nread = getline(&line, &len, fp)) != -1)
     {
-        create_APEX_instruction(&code_memory[current_instruction], line);
+        if (!create_APEX_instruction(&code_memory[current_instruction], line))
+        {
+            fprintf(stderr, "APEX_Error: %s line %d: cannot parse instruction\n", filename,
+                    current_instruction + 1);
+            free(code_memory);
+            free(line);
+            fclose(fp);
+            return NULL;
+        }
         current_instruction++;
     }
 
@@ -7,26 +7,83 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "apex_cpu.h"
 
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr,
+            "APEX_Help: Usage %s [--run-to-halt] [--quiet] [--max-cycles <n>] <input_file>\n",
+            prog);
+}
+
 int main(int argc, char const *argv[])
 {
     APEX_CPU *cpu;
+    const char *filename = NULL;
+    int run_to_halt = FALSE;
+    int quiet = FALSE;
+    long max_cycles = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--run-to-halt") == 0)
+        {
+            run_to_halt = TRUE;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            quiet = TRUE;
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            max_cycles = atol(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !filename)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
 
-    fprintf(stderr, "APEX CPU Pipeline Simulator v%0.1lf\n", VERSION);
+    if (!quiet)
+    {
+        fprintf(stderr, "APEX CPU Pipeline Simulator v%0.1lf\n", VERSION);
+    }
 
-    if (argc != 2)
+    if (!filename)
     {
-        fprintf(stderr, "APEX_Help: Usage %s <input_file>\n", argv[0]);
+        print_usage(argv[0]);
         exit(1);
     }
 
-    cpu = APEX_cpu_init(argv[1]);
+    cpu = APEX_cpu_init(filename);
     if (!cpu)
     {
         fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
         exit(1);
     }
+    cpu->quiet = quiet;
+    if (!quiet)
+    {
+        APEX_print_code_memory(cpu);
+    }
+
+    if (run_to_halt)
+    {
+        int halted = APEX_cpu_run_to_halt(cpu, max_cycles);
+
+        APEX_print_summary(cpu);
+        APEX_cpu_stop(cpu);
+        return halted ? 0 : 2;
+    }
+
     int x, y;
     while (1)
     {
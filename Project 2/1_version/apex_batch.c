@@ -0,0 +1,303 @@
+/*
+ * apex_batch.c
+ * Runs many APEX programs concurrently in one process
+ *
+ * The manifest lists one run per line: a program file followed by
+ * optional key=value settings for that run, '#' starts a comment. Besides
+ * max_cycles, fast_forward, skip and skip_to (see --skip and --skip-to in
+ * main.c), any apex_config.h key may be set.
+ *
+ *     1.asm
+ *     2.asm max_cycles=500
+ *     3.asm fast_forward=0 iq_size=16 mul_latency=5
+ *     4.asm skip=100000 max_cycles=5000
+ *
+ * Runs are spread over a work-stealing thread pool, see apex_pool.h.
+ * Every run gets its own APEX_CPU, and the result rows are written in
+ * manifest order once all runs are done.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_cpu.h"
+#include "apex_pool.h"
+
+#define MAX_LINE 1024
+
+typedef struct batch_job
+{
+    char program[MAX_LINE];
+    char settings[MAX_LINE]; /* Settings as written in the manifest */
+    APEX_Config config;
+    long max_cycles;
+    int fast_forward;
+    long skip;   /* Instructions run functionally first */
+    int skip_to; /* Or the PC to run functionally up to, -1 for none */
+    /* Result */
+    int status; /* Exit status convention of apex_sim: 0 halted, 1 error, 2 cycle limit */
+    int cycles;
+    int instructions; /* Retired by the detailed core, skip not included */
+    uint64_t state_hash;
+} batch_job;
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr,
+            "APEX_Help: Usage %s [--threads <n>] [--output <file>] <manifest>\n",
+            prog);
+}
+
+/* Applies one key=value setting to a job, FALSE if the key is unknown */
+static int
+apply_setting(batch_job *job, const char *setting)
+{
+    const char *value = strchr(setting, '=');
+
+    if (!value)
+    {
+        return FALSE;
+    }
+    value++;
+
+    if (strncmp(setting, "max_cycles=", value - setting) == 0)
+    {
+        job->max_cycles = atol(value);
+    }
+    else if (strncmp(setting, "fast_forward=", value - setting) == 0)
+    {
+        job->fast_forward = atoi(value) != 0;
+    }
+    else if (strncmp(setting, "skip=", value - setting) == 0)
+    {
+        job->skip = atol(value);
+    }
+    else if (strncmp(setting, "skip_to=", value - setting) == 0)
+    {
+        job->skip_to = atoi(value);
+    }
+    else
+    {
+        return APEX_config_set(&job->config, setting);
+    }
+    return TRUE;
+}
+
+/* Reads the manifest, returns the number of runs or -1 on a bad line */
+static int
+load_manifest(const char *filename, batch_job **jobs_out)
+{
+    char line[MAX_LINE];
+    batch_job *jobs = NULL;
+    int count = 0, capacity = 0, line_num = 0;
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open %s\n", filename);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *save, *token;
+        char *comment = strchr(line, '#');
+        batch_job *job;
+
+        line_num++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+
+        token = strtok_r(line, " \t\r\n", &save);
+        if (!token)
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            jobs = realloc(jobs, capacity * sizeof(batch_job));
+            if (!jobs)
+            {
+                fclose(fp);
+                return -1;
+            }
+        }
+
+        job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        job->fast_forward = TRUE;
+        job->skip_to = -1;
+        APEX_config_default(&job->config);
+        snprintf(job->program, sizeof(job->program), "%s", token);
+
+        while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL)
+        {
+            if (!apply_setting(job, token))
+            {
+                fprintf(stderr, "APEX_Error: %s:%d: unknown setting %s\n",
+                        filename, line_num, token);
+                free(jobs);
+                fclose(fp);
+                return -1;
+            }
+            if (job->settings[0])
+            {
+                strncat(job->settings, " ", sizeof(job->settings) - strlen(job->settings) - 1);
+            }
+            strncat(job->settings, token, sizeof(job->settings) - strlen(job->settings) - 1);
+        }
+
+        if (APEX_config_check(&job->config))
+        {
+            fprintf(stderr, "APEX_Error: %s:%d: %s is out of range\n",
+                    filename, line_num, APEX_config_check(&job->config));
+            free(jobs);
+            fclose(fp);
+            return -1;
+        }
+    }
+
+    fclose(fp);
+    *jobs_out = jobs;
+    return count;
+}
+
+/* FNV-1a over the architectural registers and data memory */
+static uint64_t
+hash_final_state(const APEX_CPU *cpu)
+{
+    const unsigned char *bytes[2] = {(const unsigned char *)cpu->regs,
+                                     (const unsigned char *)cpu->data_memory};
+    size_t sizes[2] = {sizeof(cpu->regs), sizeof(cpu->data_memory)};
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    int k;
+
+    for (k = 0; k < 2; k++)
+    {
+        for (i = 0; i < sizes[k]; i++)
+        {
+            hash = (hash ^ bytes[k][i]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static void
+run_job(batch_job *job)
+{
+    APEX_CPU *cpu = APEX_cpu_init(job->program, &job->config);
+
+    if (!cpu)
+    {
+        job->status = 1;
+        return;
+    }
+
+    cpu->trace_level = TRACE_OFF;
+    if (job->skip > 0 || job->skip_to >= 0)
+    {
+        APEX_func_run(cpu, job->skip, job->skip_to);
+        if (!APEX_cpu_enter_detailed(cpu))
+        {
+            job->status = 1;
+            APEX_cpu_stop(cpu);
+            return;
+        }
+    }
+    job->status = APEX_cpu_run_to_halt(cpu, job->max_cycles, job->fast_forward);
+    job->cycles = cpu->clock;
+    job->instructions = cpu->insn_completed;
+    job->state_hash = hash_final_state(cpu);
+    APEX_cpu_stop(cpu);
+}
+
+static void
+run_batch_job(void *ctx, int job)
+{
+    run_job(&((batch_job *)ctx)[job]);
+}
+
+int main(int argc, char const *argv[])
+{
+    const char *manifest = NULL;
+    const char *output = NULL;
+    int num_threads = apex_pool_default_threads();
+    batch_job *jobs;
+    FILE *out = stdout;
+    int num_jobs, failed = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !manifest)
+        {
+            manifest = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (!manifest)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    num_jobs = load_manifest(manifest, &jobs);
+    if (num_jobs < 0)
+    {
+        exit(1);
+    }
+
+    if (!apex_pool_run(num_jobs, num_threads, run_batch_job, jobs))
+    {
+        fprintf(stderr, "APEX_Error: Out of memory\n");
+        exit(1);
+    }
+
+    if (output)
+    {
+        out = fopen(output, "w");
+        if (!out)
+        {
+            fprintf(stderr, "APEX_Error: Unable to create %s\n", output);
+            exit(1);
+        }
+    }
+
+    fprintf(out, "program,settings,status,cycles,instructions,ipc,state_hash\n");
+    for (i = 0; i < num_jobs; i++)
+    {
+        const batch_job *job = &jobs[i];
+        static const char *status_names[] = {"halted", "error", "max_cycles"};
+
+        fprintf(out, "%s,%s,%s,%d,%d,%.3f,%016llx\n", job->program, job->settings,
+                status_names[job->status], job->cycles, job->instructions,
+                job->cycles ? (double)job->instructions / job->cycles : 0.0,
+                (unsigned long long)job->state_hash);
+        failed |= job->status != 0;
+    }
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    free(jobs);
+    return failed;
+}
@@ -0,0 +1,246 @@
+/*
+ * apex_config.c
+ * Parsing and checking of run-time microarchitecture parameters
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_config.h"
+#include "issuequeue.h"
+#include "renametable.h"
+
+typedef struct config_key
+{
+    const char *name;
+    size_t offset;
+    int min;
+    int max;
+    const char *const *names; /* Names of the values min .. max, or NULL */
+} config_key;
+
+/*
+ * Upper bounds keep tags and ROB IDs within the 16-bit trace fields. The
+ * committed mappings of the registers and the Z flag hold RAT_ENTRIES
+ * physical registers for good, so pregs needs at least one more to rename.
+ */
+static const config_key config_keys[] = {
+    {"iq_size", offsetof(APEX_Config, iq_size), 2, IQ_MAX_SIZE, NULL},
+    {"rob_size", offsetof(APEX_Config, rob_size), 2, 4096, NULL},
+    {"pregs", offsetof(APEX_Config, pregs), RAT_ENTRIES + 1, 4096, NULL},
+    {"mul_latency", offsetof(APEX_Config, mul_latency), 1, 1000, NULL},
+    {"mem_depth", offsetof(APEX_Config, mem_depth), 2, 64, NULL},
+    {"predictor", offsetof(APEX_Config, predictor), 0, NUM_PREDICTORS - 1, predictor_names},
+    {"lsq_size", offsetof(APEX_Config, lsq_size), 1, 4096, NULL},
+    {"lsq_mode", offsetof(APEX_Config, lsq_mode), 0, NUM_LSQ_MODES - 1, lsq_mode_names},
+};
+
+#define NUM_CONFIG_KEYS ((int)(sizeof(config_keys) / sizeof(config_keys[0])))
+
+void
+APEX_config_default(APEX_Config *config)
+{
+    config->iq_size = IQ_SIZE;
+    config->rob_size = ROB_SIZE;
+    config->pregs = PREGS_FILE_SIZE;
+    config->mul_latency = MUL_LATENCY;
+    config->mem_depth = MEM_DEPTH;
+    config->predictor = PREDICTOR_LAST;
+    config->lsq_size = LSQ_SIZE;
+    config->lsq_mode = LSQ_MODE_STORE_SET;
+}
+
+/* The key named by the first len characters of name, or NULL */
+static const config_key *
+find_key(const char *name, size_t len)
+{
+    int i;
+
+    for (i = 0; i < NUM_CONFIG_KEYS; i++)
+    {
+        if (strlen(config_keys[i].name) == len &&
+            strncmp(name, config_keys[i].name, len) == 0)
+        {
+            return &config_keys[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Parses a value for a key, a number or one of the key's value names.
+ * Spaces around the value are allowed. Ranges are left to
+ * APEX_config_check.
+ */
+static int
+parse_value(const config_key *key, const char *text, int *value)
+{
+    size_t len;
+    char *end;
+    long number;
+    int i;
+
+    while (*text == ' ' || *text == '\t')
+    {
+        text++;
+    }
+    len = strlen(text);
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\t'))
+    {
+        len--;
+    }
+    if (len == 0)
+    {
+        return FALSE;
+    }
+
+    number = strtol(text, &end, 10);
+    if ((size_t)(end - text) == len)
+    {
+        *value = (int)number;
+        return TRUE;
+    }
+
+    for (i = 0; key->names && i <= key->max - key->min; i++)
+    {
+        if (strlen(key->names[i]) == len && strncmp(text, key->names[i], len) == 0)
+        {
+            *value = key->min + i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Applies one "key=value" setting, spaces around '=' are allowed.
+ * Returns FALSE for an unknown key or a value that cannot be parsed.
+ */
+int
+APEX_config_set(APEX_Config *config, const char *setting)
+{
+    const char *equals = strchr(setting, '=');
+    const config_key *key;
+    size_t len;
+    int value;
+
+    if (!equals)
+    {
+        return FALSE;
+    }
+
+    len = equals - setting;
+    while (len > 0 && (setting[len - 1] == ' ' || setting[len - 1] == '\t'))
+    {
+        len--;
+    }
+
+    key = find_key(setting, len);
+    if (!key || !parse_value(key, equals + 1, &value))
+    {
+        return FALSE;
+    }
+    *(int *)((char *)config + key->offset) = value;
+    return TRUE;
+}
+
+/* Parses one value of the named key without applying it */
+int
+APEX_config_parse(const char *key, const char *text, int *value)
+{
+    const config_key *k = find_key(key, strlen(key));
+
+    return k && parse_value(k, text, value);
+}
+
+/* Applies every setting in a config file, FALSE if it is missing or bad */
+int
+APEX_config_load(APEX_Config *config, const char *filename)
+{
+    char line[256];
+    int line_num = 0;
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open %s\n", filename);
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *p = line;
+        char *comment = strchr(line, '#');
+
+        line_num++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            continue;
+        }
+
+        if (!APEX_config_set(config, p))
+        {
+            fprintf(stderr, "APEX_Error: %s:%d: bad setting %s\n", filename, line_num, p);
+            fclose(fp);
+            return FALSE;
+        }
+    }
+
+    fclose(fp);
+    return TRUE;
+}
+
+/* NULL if every parameter is in range, otherwise the offending key */
+const char *
+APEX_config_check(const APEX_Config *config)
+{
+    int i;
+
+    for (i = 0; i < NUM_CONFIG_KEYS; i++)
+    {
+        int value = *(const int *)((const char *)config + config_keys[i].offset);
+
+        if (value < config_keys[i].min || value > config_keys[i].max)
+        {
+            return config_keys[i].name;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Every parameter as space separated key=value, in a fixed order. A key
+ * with value names is written by name.
+ */
+void
+APEX_config_format(const APEX_Config *config, char *buffer, int size)
+{
+    int i, used = 0;
+
+    buffer[0] = '\0';
+    for (i = 0; i < NUM_CONFIG_KEYS && used < size; i++)
+    {
+        const config_key *key = &config_keys[i];
+        int value = *(const int *)((const char *)config + key->offset);
+
+        if (key->names && value >= key->min && value <= key->max)
+        {
+            used += snprintf(buffer + used, size - used, "%s%s=%s", i ? " " : "",
+                             key->name, key->names[value - key->min]);
+        }
+        else
+        {
+            used += snprintf(buffer + used, size - used, "%s%s=%d", i ? " " : "",
+                             key->name, value);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * apex_config.h
+ * Run-time microarchitecture parameters
+ *
+ * A config file holds one "key = value" per line, '#' starts a comment:
+ *
+ *     iq_size = 32
+ *     rob_size = 128
+ *     pregs = 96
+ *     mul_latency = 4
+ *     mem_depth = 3
+ *     predictor = gshare
+ *     lsq_size = 32
+ *     lsq_mode = head
+ *
+ * Command line overrides use the same keys as key=value.
+ */
+#ifndef _APEX_CONFIG_H_
+#define _APEX_CONFIG_H_
+
+#include "apex_macros.h"
+#include "predictor.h"
+#include "lsq.h"
+
+typedef struct APEX_Config
+{
+    int iq_size;     /* Issue queue entries, 2 .. IQ_MAX_SIZE */
+    int rob_size;    /* Reorder buffer entries */
+    int pregs;       /* Physical registers */
+    int mul_latency; /* Cycles in the MUL unit */
+    int mem_depth;   /* Memory unit stages, M1 .. Mn */
+    int predictor;   /* PREDICTOR_*, set by name in files and overrides */
+    int lsq_size;    /* Load/store queue entries */
+    int lsq_mode;    /* LSQ_MODE_*, set by name */
+} APEX_Config;
+
+void APEX_config_default(APEX_Config *config);
+int APEX_config_set(APEX_Config *config, const char *setting);
+int APEX_config_parse(const char *key, const char *text, int *value);
+int APEX_config_load(APEX_Config *config, const char *filename);
+const char *APEX_config_check(const APEX_Config *config);
+void APEX_config_format(const APEX_Config *config, char *buffer, int size);
+
+#endif
@@ -6,8 +6,11 @@
  * Copyright (c) 2020, Gaurav Kothari (gkothar1@binghamton.edu)
  * State University of New York at Binghamton
  */
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include "stagelist.h" //Reference : https://www.zentut.com/c-tutorial/c-linked-list/
+#include "apex_cpu.h"
+#include "apex_trace.h"
 
 /* Converts the PC(4000 series) into array index for code memory
  *
@@ -19,12 +22,90 @@ get_code_memory_index_from_pc(const int pc)
     return (pc - 4000) / 4;
 }
 
+/*
+ * Stage trace hook: a text line when the stage is enabled for printing
+ * and a binary event when a trace file is open
+ */
 static void
-print_instruction(const CPU_Stage *stage)
+trace_stage(const APEX_CPU *cpu, int stage_id, const CPU_Stage *stage)
 {
-    switch (stage->opcode)
+    if (stage->opcode == OPCODE_NULL)
+    {
+        return;
+    }
+
+    if (cpu->event_trace)
+    {
+        apex_trace_emit(cpu->event_trace, cpu->clock + 1, stage_id, stage);
+    }
+    if (TRACE_STAGE_ON(cpu, stage_id))
+    {
+        APEX_print_stage(stage_id, stage);
+    }
+}
+
+/* Debug function which prints the register file
+ *
+ * Note: You are not supposed to edit this function
+ */
+static void
+print_reg_file(const APEX_CPU *cpu)
+{
+    int i;
+
+    printf("----------\n%s\n----------\n", "Registers:");
+
+    for (int i = 0; i < REG_FILE_SIZE / 2; ++i)
+    {
+        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
+    }
+
+    printf("\n");
+
+    for (i = (REG_FILE_SIZE / 2); i < REG_FILE_SIZE; ++i)
+    {
+        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
+    }
+
+    printf("\n");
+}
+
+/* Branches and jumps, the instructions that take a rename checkpoint */
+static int
+is_control_transfer(int opcode)
+{
+    return opcode == OPCODE_BZ || opcode == OPCODE_BNZ ||
+           opcode == OPCODE_JUMP || opcode == OPCODE_JAL;
+}
+
+/* Conditional branches, the instructions the predictor sees */
+static int
+is_branch(int opcode)
+{
+    return opcode == OPCODE_BZ || opcode == OPCODE_BNZ;
+}
+
+/* Functions return with JUMP Rx,#0, those are predicted from the RAS */
+static int
+is_return(const CPU_Stage *stage)
+{
+    return stage->opcode == OPCODE_JUMP && stage->imm == 0;
+}
+
+/* Loads and stores, the instructions that take an LSQ entry */
+static int
+is_memory_op(int opcode)
+{
+    return opcode == OPCODE_LOAD || opcode == OPCODE_LDR ||
+           opcode == OPCODE_STORE || opcode == OPCODE_STR;
+}
+
+/* Instructions that rename a destination register */
+static int
+writes_register(int opcode)
+{
+    switch (opcode)
     {
-    case OPCODE_STR:
     case OPCODE_ADD:
     case OPCODE_SUB:
     case OPCODE_MUL:
@@ -32,196 +113,332 @@ print_instruction(const CPU_Stage *stage)
     case OPCODE_AND:
     case OPCODE_OR:
     case OPCODE_XOR:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_MOVC:
+    case OPCODE_LOAD:
     case OPCODE_LDR:
-    {
-        printf("%s,R%d,R%d,R%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->rs2);
-        break;
+    case OPCODE_JAL:
+        return TRUE;
+    default:
+        return FALSE;
     }
+}
 
-    case OPCODE_MOVC:
+/* Instructions that write the Z flag read by BZ and BNZ */
+static int
+sets_flag(int opcode)
+{
+    switch (opcode)
     {
-        printf("%s,R%d,#%d", stage->opcode_str, stage->rd, stage->imm);
-        break;
-    }
-
-    case OPCODE_LOAD:
+    case OPCODE_CMP:
+    case OPCODE_ADD:
     case OPCODE_ADDL:
+    case OPCODE_SUB:
     case OPCODE_SUBL:
-    case OPCODE_JAL:
-    {
-        printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-               stage->imm);
-        break;
+        return TRUE;
+    default:
+        return FALSE;
     }
+}
 
-    case OPCODE_STORE:
-    {
-        printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rs1, stage->rs2,
-               stage->imm);
-        break;
-    }
+/* Physical registers an instruction takes from the free list at dispatch */
+static int
+pregs_needed(int opcode)
+{
+    return writes_register(opcode) + sets_flag(opcode);
+}
 
-    case OPCODE_BZ:
-    case OPCODE_BNZ:
+/* Snapshots the rename table and free list for a branch being dispatched */
+static int
+take_checkpoint(APEX_CPU *cpu)
+{
+    int slot = rat_checkpoint(&cpu->rat);
+
+    if (slot != RAT_NO_CHECKPOINT)
     {
-        printf("%s,#%d ", stage->opcode_str, stage->imm);
-        break;
+        freelist_checkpoint(&cpu->fl, slot);
     }
-    case OPCODE_JUMP:
+    return slot;
+}
+
+/* The branch in this slot committed without squashing anything */
+static void
+release_checkpoint(APEX_CPU *cpu, int slot)
+{
+    rat_release(&cpu->rat, slot);
+    freelist_release(&cpu->fl, slot);
+}
+
+/*
+ * Rename state goes back to the branch's snapshot. Only the checkpoints of
+ * the older branches in keep stay live, the rest belonged to squashed
+ * younger branches.
+ */
+static void
+restore_checkpoint(APEX_CPU *cpu, int slot, unsigned int keep)
+{
+    rat_restore(&cpu->rat, slot);
+    freelist_restore(&cpu->fl, slot);
+    rat_retain(&cpu->rat, keep);
+    freelist_retain(&cpu->fl, keep);
+}
+
+/*
+ * A branch resolved as predicted. Its tag is cleared from every waiting
+ * instruction before the slot can be handed to another branch.
+ */
+static void
+resolve_branch(APEX_CPU *cpu, int slot)
+{
+    unsigned int tag = 1u << slot;
+    const iq_mask *valid = &cpu->iq.valid_mask;
+    int i;
+
+    release_checkpoint(cpu, slot);
+    for (i = iq_next_slot(&cpu->iq, valid, 0); i >= 0; i = iq_next_slot(&cpu->iq, valid, i + 1))
     {
-        printf("%s R%d,#%d ", stage->opcode_str, stage->rs1, stage->imm);
-        break;
+        cpu->iq.entry[i].branch_mask &= ~tag;
     }
+    cpu->issueq.branch_mask &= ~tag;
+    cpu->mulfu.branch_mask &= ~tag;
+}
 
-    case OPCODE_CMP:
+/* Drops the LSQ entries and in-flight memory ops that are no longer in the ROB */
+static void
+squash_memory_ops(APEX_CPU *cpu)
+{
+    int i;
+
+    while (cpu->lsq.count &&
+           !rob_contains(&cpu->robq, lsq_at(&cpu->lsq, cpu->lsq.count - 1)->rob_id))
     {
-        printf("%s R%d,R%d ", stage->opcode_str, stage->rs1, stage->rs2);
-        break;
+        lsq_pop_tail(&cpu->lsq);
     }
-
-    case OPCODE_HALT:
+    for (i = 0; i < cpu->config.mem_depth - 2; i++)
     {
-        printf("%s", stage->opcode_str);
-        break;
+        if (!rob_contains(&cpu->robq, cpu->mem_pipe[i].rob_id))
+        {
+            cpu->mem_pipe[i].has_insn = FALSE;
+        }
     }
-
-    case OPCODE_NULL:
+    if (!rob_contains(&cpu->robq, cpu->memory1.rob_id))
     {
-        printf(" ");
-        break;
+        cpu->memory1.has_insn = FALSE;
     }
-    case OPCODE_NOP:
-        printf("%s", stage->opcode_str);
+    if (!rob_contains(&cpu->robq, cpu->memory2.rob_id))
+    {
+        cpu->memory2.has_insn = FALSE;
     }
 }
 
+/*
+ * Mispredicted branch, or a jump, recovering in JBU1. Instructions that
+ * carry the branch's tag are squashed from the IQ, the latch on its way
+ * to the IQ and the MUL unit, and the ROB is cut back to the branch. The
+ * LSQ and the memory unit drop every op that is no longer in the ROB.
+ * Fetch restarts at target in the same cycle.
+ */
 static void
-print_instruction_with_renamed_registers(const CPU_Stage *stage)
+squash_younger(APEX_CPU *cpu, const CPU_Stage *branch, int target)
 {
-    switch (stage->opcode)
+    unsigned int tag = 1u << branch->checkpoint;
+    const iq_mask *valid = &cpu->iq.valid_mask;
+    int i;
+
+    restore_checkpoint(cpu, branch->checkpoint, branch->branch_mask);
+    rob_squash_after(&cpu->robq, branch->rob_id);
+    squash_memory_ops(cpu);
+    predictor_restore(&cpu->predictor, branch->pred_history);
+    ras_restore(&cpu->ras, &branch->ras);
+    if (is_branch(branch->opcode))
     {
-    case OPCODE_STR:
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_DIV:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_XOR:
-    case OPCODE_LDR:
+        predictor_speculate(&cpu->predictor, cpu->robq.entry[branch->rob_id].branch_taken);
+    }
+    else if (branch->opcode == OPCODE_JAL)
     {
-        printf("%s,R%d,R%d,R%d\t\t%s,P%d,P%d,P%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->rs2, stage->opcode_str, stage->pd, stage->ps1, stage->ps2);
-        break;
+        ras_push(&cpu->ras, branch->pc + 4);
     }
-
-    case OPCODE_MOVC:
+    else if (is_return(branch))
     {
-        printf("%s,R%d,#%d\t\t%s,P%d,#%d", stage->opcode_str, stage->rd, stage->imm, stage->opcode_str, stage->pd, stage->imm);
-        break;
+        ras_pop(&cpu->ras);
     }
-
-    case OPCODE_LOAD:
-    case OPCODE_ADDL:
-    case OPCODE_SUBL:
-    case OPCODE_JAL:
+    for (i = iq_next_slot(&cpu->iq, valid, 0); i >= 0; i = iq_next_slot(&cpu->iq, valid, i + 1))
     {
-        printf("%s,R%d,R%d,#%d\t\t%s,P%d,P%d,#%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->imm, stage->opcode_str, stage->pd, stage->ps1, stage->imm);
-        break;
+        if (cpu->iq.entry[i].branch_mask & tag)
+        {
+            iq_remove(&cpu->iq, i);
+        }
     }
-
-    case OPCODE_STORE:
+    if (cpu->issueq.branch_mask & tag)
     {
-        printf("%s,R%d,R%d,#%d\t%s,P%d,P%d,#%d", stage->opcode_str, stage->rs1, stage->rs2,
-               stage->imm, stage->opcode_str, stage->ps1, stage->ps2, stage->imm);
-        break;
+        cpu->issueq.has_insn = FALSE;
     }
-
-    case OPCODE_BZ:
-    case OPCODE_BNZ:
+    if (cpu->mulfu.has_insn && (cpu->mulfu.branch_mask & tag))
     {
-        printf("%s,#%d", stage->opcode_str, stage->imm);
-        break;
+        cpu->mulfu.has_insn = FALSE;
+        cpu->mulstage = 0;
     }
+    cpu->decode.flush = 1;
+    cpu->pc = target;
+}
 
-    case OPCODE_CMP:
+/*
+ * Memory order violation: the load in this ROB entry read memory before an
+ * older store to the same address resolved. The load and everything
+ * younger are squashed and fetched again. A load holds no rename
+ * checkpoint, so the squashed instructions' mappings are undone one at a
+ * time, youngest first, and the checkpoints of squashed unresolved
+ * branches are freed. Called when the store leaves the IQ, after the
+ * function units have run, so the MUL unit is the only one that can hold
+ * a squashed instruction.
+ */
+static void
+replay_load(APEX_CPU *cpu, int rob_id)
+{
+    const CPU_Stage load = cpu->robq.entry[rob_id];
+    const iq_mask *valid = &cpu->iq.valid_mask;
+    int i, k;
+
+    for (k = cpu->robq.count - 1; rob_at(&cpu->robq, k)->rob_id != rob_id; k--)
     {
-        printf("%s R%d,R%d\t\t%s P%d,P%d", stage->opcode_str, stage->rs1, stage->rs2, stage->opcode_str, stage->ps1, stage->ps2);
-        break;
+        const CPU_Stage *e = rob_at(&cpu->robq, k);
+
+        if (is_control_transfer(e->opcode) && !e->branch_done)
+        {
+            release_checkpoint(cpu, e->checkpoint);
+        }
+        if (e->pf >= 0)
+        {
+            rat_rename(&cpu->rat, RAT_FLAG, e->prev_pf);
+            freelist_unalloc(&cpu->fl, e->pf);
+        }
+        if (writes_register(e->opcode))
+        {
+            rat_rename(&cpu->rat, e->rd, e->prev_pd);
+            freelist_unalloc(&cpu->fl, e->pd);
+        }
     }
+    rat_rename(&cpu->rat, load.rd, load.prev_pd);
+    freelist_unalloc(&cpu->fl, load.pd);
 
-    case OPCODE_HALT:
+    rob_squash_from(&cpu->robq, rob_id);
+    squash_memory_ops(cpu);
+    for (i = iq_next_slot(&cpu->iq, valid, 0); i >= 0; i = iq_next_slot(&cpu->iq, valid, i + 1))
     {
-        printf("%s", stage->opcode_str);
-        break;
+        if (!rob_contains(&cpu->robq, cpu->iq.entry[i].rob_id))
+        {
+            iq_remove(&cpu->iq, i);
+        }
     }
-    case OPCODE_JUMP:
+    if (cpu->mulfu.has_insn && !rob_contains(&cpu->robq, cpu->mulfu.rob_id))
     {
-        printf("%s R%d,#%d\t\t%s P%d,#%d", stage->opcode_str, stage->rs1, stage->imm, stage->opcode_str, stage->ps1, stage->imm);
-        break;
+        cpu->mulfu.has_insn = FALSE;
+        cpu->mulstage = 0;
     }
+    predictor_restore(&cpu->predictor, load.pred_history);
+    ras_restore(&cpu->ras, &load.ras);
+    cpu->decode.flush = 1;
+    cpu->pc = load.pc;
+    cpu->load_replays++;
+}
 
-    case OPCODE_NULL:
+/* Counts a committed branch or jump against its static instruction and the totals */
+static void
+record_branch(APEX_CPU *cpu, const CPU_Stage *branch)
+{
+    branch_stats *stats[2] = {&cpu->branch_stats[get_code_memory_index_from_pc(branch->pc)],
+                              is_branch(branch->opcode) ? &cpu->branch_totals :
+                                                          &cpu->jump_totals};
+    int i;
+
+    for (i = 0; i < 2; i++)
     {
-        printf(" ");
-        break;
-    }
-    case OPCODE_NOP:
-        printf("%s", stage->opcode_str);
+        stats[i]->executed++;
+        stats[i]->btb_hits += branch->btb_hit;
+        stats[i]->mispredicts += branch->mispredicted;
     }
 }
 
-/* Debug function which prints the CPU stage content
- *
- * Note: You can edit this function to print in more detail
- */
+/* Marks a physical register valid and wakes up IQ entries waiting on it */
 static void
-print_stage_content(const char *name, const CPU_Stage *stage)
+broadcast_tag(APEX_CPU *cpu, int preg)
 {
-    printf("%-15s: pc(%d) ", name, stage->pc);
-    //print_instruction(stage);
-    print_instruction_with_renamed_registers(stage);
-
-    printf("\n");
+    cpu->pregs_valid[preg] = 1;
+    iq_wakeup(&cpu->iq, preg);
 }
-/* Debug function which prints the CPU stage content
- *
- * Note: You can edit this function to print in more detail
+
+/*
+ * First stage of the memory unit. With more than two memory stages it is
+ * the one ahead of memory1. It takes one op per cycle.
  */
-static void
-print_stage_content_for_fetch(const char *name, const CPU_Stage *stage)
+static CPU_Stage *
+memory_entry(APEX_CPU *cpu)
 {
-    printf("%-15s: pc(%d) ", name, stage->pc);
-    print_instruction(stage);
-    printf("\n");
+    return cpu->config.mem_depth > 2 ? &cpu->mem_pipe[0] : &cpu->memory1;
 }
 
-/* Debug function which prints the register file
- *
- * Note: You are not supposed to edit this function
- */
+/* Sends a memory op, given by its ROB entry, to the memory unit */
 static void
-print_reg_file(const APEX_CPU *cpu)
+issue_memory_op(APEX_CPU *cpu, CPU_Stage *op)
 {
-    int i;
+    CPU_Stage *stage = memory_entry(cpu);
 
-    printf("----------\n%s\n----------\n", "Registers:");
+    *stage = *op;
+    stage->has_insn = TRUE;
+    op->mem_issued = TRUE;
+    cpu->lsq.entry[op->lsq_id].issued = TRUE;
+}
 
-    for (int i = 0; i < REG_FILE_SIZE / 2; ++i)
+/* Fills in a memory op's LSQ entry once its register operands are valid */
+static void
+compute_address(APEX_CPU *cpu, const CPU_Stage *op)
+{
+    const int *value = cpu->renameTableValues;
+
+    switch (op->opcode)
     {
-        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
+    case OPCODE_LOAD:
+        lsq_set_address(&cpu->lsq, op->lsq_id, value[op->ps1] + op->imm, 0);
+        break;
+    case OPCODE_LDR:
+        lsq_set_address(&cpu->lsq, op->lsq_id, value[op->ps1] + value[op->ps2], 0);
+        break;
+    case OPCODE_STORE:
+        lsq_set_address(&cpu->lsq, op->lsq_id, value[op->ps2] + op->imm, value[op->ps1]);
+        break;
+    case OPCODE_STR:
+        lsq_set_address(&cpu->lsq, op->lsq_id, value[op->ps1] + value[op->ps2],
+                        value[op->pd]);
+        break;
     }
+}
 
-    printf("\n");
-
-    for (i = (REG_FILE_SIZE / 2); i < REG_FILE_SIZE; ++i)
+/* First resource the instruction in decode is waiting for, or STALL_NONE */
+static int
+decode_stall_cause(const APEX_CPU *cpu)
+{
+    if (cpu->iq.count >= cpu->iq.size - 1)
     {
-        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
+        return STALL_IQ_FULL;
     }
-
-    printf("\n");
+    if (cpu->robq.count >= cpu->robq.size)
+    {
+        return STALL_ROB_FULL;
+    }
+    if (pregs_needed(cpu->decode.opcode) > cpu->fl.count)
+    {
+        return STALL_NO_PREG;
+    }
+    if (is_control_transfer(cpu->decode.opcode) && !rat_checkpoint_available(&cpu->rat))
+    {
+        return STALL_NO_CHECKPOINT;
+    }
+    if (is_memory_op(cpu->decode.opcode) && lsq_full(&cpu->lsq))
+    {
+        return STALL_LSQ_FULL;
+    }
+    return STALL_NONE;
 }
 
 /*
@@ -232,7 +449,10 @@ print_reg_file(const APEX_CPU *cpu)
 static void
 APEX_fetch(APEX_CPU *cpu)
 {
-    APEX_Instruction *current_ins;
+    static const APEX_Instruction empty_ins; /* Read past the end of code memory */
+    const APEX_Instruction *current_ins;
+    const btb_entry *btb;
+    int index;
 
     if (cpu->decode.stalled == 1)
     {
@@ -245,10 +465,10 @@ APEX_fetch(APEX_CPU *cpu)
 
     if (cpu->fetch.flush == 1)
     {
-        strcpy(cpu->fetch.opcode_str, " ");
         cpu->fetch.opcode = 0x0;
         cpu->fetch.pc = '\0';
         cpu->fetch.flush = 0;
+        cpu->cycle_activity = TRUE;
         return;
     }
 
@@ -256,6 +476,7 @@ APEX_fetch(APEX_CPU *cpu)
     if (cpu->fetch_from_next_cycle == TRUE)
     {
         cpu->fetch_from_next_cycle = FALSE;
+        cpu->cycle_activity = TRUE;
 
         /* Skip this cycle*/
         return;
@@ -266,8 +487,9 @@ APEX_fetch(APEX_CPU *cpu)
 
     /* Index into code memory using this pc and copy all instruction fields
          * into fetch latch  */
-    current_ins = &cpu->code_memory[get_code_memory_index_from_pc(cpu->pc)];
-    strcpy(cpu->fetch.opcode_str, current_ins->opcode_str);
+    index = get_code_memory_index_from_pc(cpu->pc);
+    current_ins = index >= 0 && index < cpu->code_memory_size ?
+                      &cpu->code_memory[index] : &empty_ins;
     cpu->fetch.opcode = current_ins->opcode;
     cpu->fetch.rd = current_ins->rd;
     cpu->fetch.rs1 = current_ins->rs1;
@@ -275,14 +497,48 @@ APEX_fetch(APEX_CPU *cpu)
     cpu->fetch.imm = current_ins->imm;
     if (cpu->fetch.opcode == 0)
     {
-        strcpy(cpu->fetch.opcode_str, " ");
         cpu->fetch.pc = '\0';
     }
 
+    /*
+     * The BTB, the direction predictor and the RAS are looked up in
+     * parallel with the fetch. A return goes to the RAS top, any other
+     * control transfer needs a BTB entry to be predicted taken.
+     */
+    btb = btb_lookup(&cpu->btb, cpu->fetch.pc);
+    cpu->fetch.btb_hit = btb != NULL;
+    cpu->fetch.pred_history = predictor_checkpoint(&cpu->predictor);
+    cpu->fetch.ras = ras_save(&cpu->ras);
+    if (is_return(&cpu->fetch))
+    {
+        cpu->fetch.pred_taken = !ras_empty(&cpu->ras);
+        cpu->fetch.pred_pc = cpu->fetch.pred_taken ? ras_peek(&cpu->ras) : cpu->pc + 4;
+    }
+    else
+    {
+        cpu->fetch.pred_taken = btb != NULL && (!is_branch(cpu->fetch.opcode) ||
+                                                predictor_predict(&cpu->predictor, cpu->fetch.pc));
+        cpu->fetch.pred_pc = cpu->fetch.pred_taken ? btb->target : cpu->pc + 4;
+    }
+
     if (cpu->fetch.has_insn && (!cpu->fetch.stalled))
     {
+        if (is_branch(cpu->fetch.opcode))
+        {
+            predictor_speculate(&cpu->predictor, cpu->fetch.pred_taken);
+        }
+        else if (cpu->fetch.opcode == OPCODE_JAL)
+        {
+            ras_push(&cpu->ras, cpu->fetch.pc + 4);
+        }
+        else if (is_return(&cpu->fetch))
+        {
+            ras_pop(&cpu->ras);
+        }
+
         /* Update PC for next instruction */
-        cpu->pc += 4;
+        cpu->pc = cpu->fetch.pred_pc;
+        cpu->cycle_activity = TRUE;
 
         /* Copy data from fetch latch to decode latch*/
         if (cpu->decode.stalled == 0)
@@ -291,10 +547,7 @@ APEX_fetch(APEX_CPU *cpu)
         }
     }
 
-    if (ENABLE_DEBUG_MESSAGES && cpu->fetch.opcode != OPCODE_NULL)
-    {
-        print_stage_content_for_fetch("Fetch", &cpu->fetch);
-    }
+    trace_stage(cpu, STAGE_FETCH, &cpu->fetch);
 }
 
 /*
@@ -308,10 +561,10 @@ APEX_decode(APEX_CPU *cpu)
 
     if (cpu->decode.flush == 1)
     {
-        strcpy(cpu->decode.opcode_str, " ");
         cpu->decode.opcode = 0x0;
         cpu->decode.pc = 0000;
         cpu->decode.flush = 0;
+        cpu->cycle_activity = TRUE;
     }
     if (cpu->decode.stalled == 1)
     {
@@ -324,24 +577,57 @@ APEX_decode(APEX_CPU *cpu)
         cpu->rob.flush =0;
     }
 
+    /*
+     * Hold the instruction in D until the IQ, ROB, a free physical register
+     * and, for a control transfer, a rename checkpoint or, for a memory op,
+     * an LSQ entry are available. Nothing is renamed until then, so the
+     * instruction can simply retry next cycle.
+     */
+    cpu->stall_cause = STALL_NONE;
+    if (cpu->decode.has_insn && (!cpu->decode.stalled))
+    {
+        cpu->stall_cause = decode_stall_cause(cpu);
+        if (cpu->stall_cause != STALL_NONE)
+        {
+            cpu->decode.stalled = 1;
+            cpu->stalls[cpu->stall_cause]++;
+        }
+    }
+
     if (cpu->decode.has_insn && (!cpu->decode.stalled))
     {
         cpu->decode.instype = 0;
+        cpu->decode.mem_ready = FALSE;
+        cpu->decode.checkpoint = RAT_NO_CHECKPOINT;
+        cpu->decode.branch_mask = cpu->rat.used_mask;
+        cpu->decode.prev_pd = -1;
+        cpu->decode.pf = -1;
+        cpu->decode.prev_pf = -1;
+        cpu->decode.rob_id = cpu->robq.tail;
+        cpu->decode.lsq_id = LSQ_NONE;
+        if (is_memory_op(cpu->decode.opcode))
+        {
+            cpu->decode.lsq_id = lsq_push(&cpu->lsq, cpu->decode.rob_id, cpu->decode.pc,
+                                          cpu->decode.opcode == OPCODE_STORE ||
+                                              cpu->decode.opcode == OPCODE_STR,
+                                          store_set_lookup(&cpu->store_sets, cpu->decode.pc));
+        }
+        cpu->cycle_activity = TRUE;
         /* Read operands from register file based on the instruction type */
         switch (cpu->decode.opcode)
         {
 
         case OPCODE_STR:
         {
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = searchprftop(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = searchprftop(rfprf, cpu->decode.rd);
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.ps2 = rat_lookup(&cpu->rat, cpu->decode.rs2);
+            cpu->decode.pd = rat_lookup(&cpu->rat, cpu->decode.rd);
 
             if (cpu->pregs_valid[cpu->decode.ps1] && cpu->pregs_valid[cpu->decode.ps2] && cpu->pregs_valid[cpu->decode.pd])
             {
-                cpu->mem_valid[cpu->renameTableValues[cpu->decode.ps1] + cpu->renameTableValues[cpu->decode.ps2]] = 0;
+                compute_address(cpu, &cpu->decode);
                 cpu->decode.instype = 1;
-                cpu->mreadybit[cpu->decode.pc] = 1;
+                cpu->decode.mem_ready = TRUE;
             }
 
             break;
@@ -349,15 +635,15 @@ APEX_decode(APEX_CPU *cpu)
 
         case OPCODE_STORE:
         {
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = searchprftop(rfprf, cpu->decode.rs2);
-            // cpu->decode.pd = searchprftop(rfprf, cpu->decode.rd);
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.ps2 = rat_lookup(&cpu->rat, cpu->decode.rs2);
+            // cpu->decode.pd = rat_lookup(&cpu->rat, cpu->decode.rd);
 
             if (cpu->pregs_valid[cpu->decode.ps1] && cpu->pregs_valid[cpu->decode.ps2])
             {
-                cpu->mem_valid[cpu->decode.imm + cpu->renameTableValues[cpu->decode.ps2]] = 0;
+                compute_address(cpu, &cpu->decode);
                 cpu->decode.instype = 1;
-                cpu->mreadybit[cpu->decode.pc] = 1;
+                cpu->decode.mem_ready = TRUE;
             }
 
             break;
@@ -366,19 +652,17 @@ APEX_decode(APEX_CPU *cpu)
         case OPCODE_LDR:
         {
 
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = searchprftop(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = phead->data;
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.ps2 = rat_lookup(&cpu->rat, cpu->decode.rs2);
+            cpu->decode.pd = freelist_alloc(&cpu->fl);
             cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prependIntoRenameTable(rfprf, renametable);
-            phead = dequeueReg(phead);
+            cpu->decode.prev_pd = rat_rename(&cpu->rat, cpu->decode.rd, cpu->decode.pd);
 
             if (cpu->pregs_valid[cpu->decode.ps1] && cpu->pregs_valid[cpu->decode.ps2])
             {
+                compute_address(cpu, &cpu->decode);
                 cpu->decode.instype = 1;
-                cpu->mreadybit[cpu->decode.pc] = 1;
+                cpu->decode.mem_ready = TRUE;
             }
 
             break;
@@ -387,18 +671,16 @@ APEX_decode(APEX_CPU *cpu)
         case OPCODE_LOAD:
         {
 
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.pd = phead->data;
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.pd = freelist_alloc(&cpu->fl);
             cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prependIntoRenameTable(rfprf, renametable);
-            phead = dequeueReg(phead);
+            cpu->decode.prev_pd = rat_rename(&cpu->rat, cpu->decode.rd, cpu->decode.pd);
 
             if (cpu->pregs_valid[cpu->decode.ps1])
             {
+                compute_address(cpu, &cpu->decode);
                 cpu->decode.instype = 1;
-                cpu->mreadybit[cpu->decode.pc] = 1;
+                cpu->decode.mem_ready = TRUE;
             }
 
             break;
@@ -406,8 +688,8 @@ APEX_decode(APEX_CPU *cpu)
 
         case OPCODE_CMP:
         {
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = searchprftop(rfprf, cpu->decode.rs2);
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.ps2 = rat_lookup(&cpu->rat, cpu->decode.rs2);
             break;
         }
 
@@ -420,14 +702,11 @@ APEX_decode(APEX_CPU *cpu)
         case OPCODE_XOR:
         {
             
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = searchprftop(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = phead->data;
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.ps2 = rat_lookup(&cpu->rat, cpu->decode.rs2);
+            cpu->decode.pd = freelist_alloc(&cpu->fl);
             cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prependIntoRenameTable(rfprf, renametable);
-            phead = dequeueReg(phead);
+            cpu->decode.prev_pd = rat_rename(&cpu->rat, cpu->decode.rd, cpu->decode.pd);
             
 
             break;
@@ -438,26 +717,25 @@ APEX_decode(APEX_CPU *cpu)
         case OPCODE_SUBL:
         case OPCODE_JAL:
         {
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
-            cpu->decode.pd = phead->data;
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.pd = freelist_alloc(&cpu->fl);
             cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prependIntoRenameTable(rfprf, renametable);
-            phead = dequeueReg(phead);
+            cpu->decode.prev_pd = rat_rename(&cpu->rat, cpu->decode.rd, cpu->decode.pd);
 
+            /* JAL keeps its own link register mapping across a squash */
+            if (cpu->decode.opcode == OPCODE_JAL)
+            {
+                cpu->decode.checkpoint = take_checkpoint(cpu);
+            }
             break;
         }
 
         case OPCODE_MOVC:
         {
 
-            cpu->decode.pd = phead->data;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
+            cpu->decode.pd = freelist_alloc(&cpu->fl);
             cpu->pregs_valid[cpu->decode.pd] = 0;
-            rfprf = prependIntoRenameTable(rfprf, renametable);
-            phead = dequeueReg(phead);
+            cpu->decode.prev_pd = rat_rename(&cpu->rat, cpu->decode.rd, cpu->decode.pd);
 
             break;
         }
@@ -465,13 +743,15 @@ APEX_decode(APEX_CPU *cpu)
         case OPCODE_BNZ:
         case OPCODE_BZ:
         {
-
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, RAT_FLAG);
+            cpu->decode.checkpoint = take_checkpoint(cpu);
             break;
         }
 
         case OPCODE_JUMP:
         {
-            cpu->decode.ps1 = searchprftop(rfprf, cpu->decode.rs1);
+            cpu->decode.ps1 = rat_lookup(&cpu->rat, cpu->decode.rs1);
+            cpu->decode.checkpoint = take_checkpoint(cpu);
             break;
         }
 
@@ -486,6 +766,14 @@ APEX_decode(APEX_CPU *cpu)
             break;
         }
         }
+
+        /* Flag producers rename Z, so compare-and-branch pairs can overlap */
+        if (sets_flag(cpu->decode.opcode))
+        {
+            cpu->decode.pf = freelist_alloc(&cpu->fl);
+            cpu->pregs_valid[cpu->decode.pf] = 0;
+            cpu->decode.prev_pf = rat_rename(&cpu->rat, RAT_FLAG, cpu->decode.pf);
+        }
     }
 
     /* Copy data from decode latch to intfu latch*/
@@ -493,29 +781,135 @@ APEX_decode(APEX_CPU *cpu)
     {
         if (cpu->decode.instype == 0)
         {
-            if(count(iqhead) < 23 && count(robhead) < 64){
             cpu->issueq = cpu->decode;
-            cpu->rob = cpu->decode;}
-            else{
-                cpu->decode.stalled = 1;
-            }
         }
-        else
+        cpu->rob = cpu->decode;
+        cpu->decode.has_insn = FALSE;
+        cpu->cycle_activity = TRUE;
+    }
+
+    trace_stage(cpu, STAGE_DECODE, &cpu->decode);
+}
+
+/*
+ * Sends the IQ entry in slot to its function unit, reading its register
+ * operands. Memory ops only generate their address here, the LSQ issues
+ * them to the memory unit.
+ */
+static void
+issue_instruction(APEX_CPU *cpu, int slot)
+{
+    CPU_Stage *entry = &cpu->iq.entry[slot];
+
+    switch (entry->opcode)
+    {
+
+    case OPCODE_STR:
+    case OPCODE_STORE:
+    {
+        int load;
+
+        compute_address(cpu, entry);
+        cpu->robq.entry[entry->rob_id].mem_ready = TRUE;
+
+        /* A younger load that went ahead of this store read stale data */
+        load = lsq_find_violation(&cpu->lsq, entry->lsq_id);
+        if (load != LSQ_NONE)
         {
-            if(count(robhead) < 64){
-           
-            cpu->rob = cpu->decode;}
-            else{
-                cpu->decode.stalled = 1;
-            }
+            store_set_train(&cpu->store_sets, cpu->lsq.entry[load].pc, entry->pc);
+            replay_load(cpu, cpu->lsq.entry[load].rob_id);
         }
-        cpu->decode.has_insn = FALSE;
+        break;
     }
 
-    if (ENABLE_DEBUG_MESSAGES && cpu->decode.opcode != OPCODE_NULL)
+    case OPCODE_LDR:
+    case OPCODE_LOAD:
     {
-        print_stage_content("Decode/RF", &cpu->decode);
+        compute_address(cpu, entry);
+        cpu->pregs_valid[entry->pd] = 0;
+        cpu->robq.entry[entry->rob_id].mem_ready = TRUE;
+        break;
     }
+
+    case OPCODE_CMP:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        entry->ps2_value = cpu->renameTableValues[entry->ps2];
+        cpu->intfu = *entry;
+        break;
+    }
+
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        entry->ps2_value = cpu->renameTableValues[entry->ps2];
+        cpu->pregs_valid[entry->pd] = 0;
+        cpu->intfu = *entry;
+        break;
+    }
+
+    case OPCODE_JUMP:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        cpu->jbu1 = *entry;
+        break;
+    }
+
+    case OPCODE_JAL:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        cpu->pregs_valid[entry->pd] = 0;
+        cpu->jbu1 = *entry;
+        break;
+    }
+
+    case OPCODE_BNZ:
+    case OPCODE_BZ:
+    {
+        /* Before the first flag producer Z is the committed flag */
+        entry->ps1_value = entry->ps1 == cpu->rat.unmapped ?
+                               cpu->zero_flag : cpu->renameTableValues[entry->ps1];
+        cpu->jbu1 = *entry;
+        break;
+    }
+
+    case OPCODE_MUL:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        entry->ps2_value = cpu->renameTableValues[entry->ps2];
+        cpu->pregs_valid[entry->pd] = 0;
+        cpu->mulfu = *entry;
+        break;
+    }
+
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    {
+        entry->ps1_value = cpu->renameTableValues[entry->ps1];
+        cpu->pregs_valid[entry->pd] = 0;
+        cpu->intfu = *entry;
+        break;
+    }
+
+    case OPCODE_MOVC:
+    {
+        /* MOVC doesn't have register operands */
+        cpu->intfu = *entry;
+        cpu->pregs_valid[entry->pd] = 0;
+        break;
+    }
+
+    default:
+    {
+        break;
+    }
+    }
+    iq_remove(&cpu->iq, slot);
 }
 
 /*
@@ -526,239 +920,66 @@ APEX_decode(APEX_CPU *cpu)
 static void
 APEX_issueq(APEX_CPU *cpu)
 {
+    int fu_class;
 
     /**
-     * 
-     * Issue queue is deployed as a list.
-     * The decode instruction is appended to the issue queue( from the last part);
-     * 
+     *
+     * Issue queue is a fixed slot array (see issuequeue.h).
+     * The decoded instruction takes a free slot and the oldest ready entry
+     * of each function unit class is issued.
+     *
      */
     if (cpu->issueq.flush == 1)
     {
-        strcpy(cpu->issueq.opcode_str, " ");
         cpu->issueq.opcode = 0x0;
         cpu->issueq.pc = 0000;
         cpu->issueq.flush = 0;
+        cpu->cycle_activity = TRUE;
     }
 
     if (cpu->issueq.opcode != 0x0 && cpu->issueq.has_insn == TRUE)
     {
-        iqhead = enqueue(iqhead, cpu->issueq);
+        iq_dispatch(&cpu->iq, &cpu->issueq, cpu->pregs_valid, cpu->clock);
+        cpu->cycle_activity = TRUE;
     }
     if (cpu->issueq.opcode == 0xc)
     {
         cpu->decode.flush = 1;
     }
 
-    node *cursor = iqhead;
-    while (cursor != NULL)
+    if (cpu->event_trace || TRACE_STAGE_ON(cpu, STAGE_ISSUEQ))
     {
-        if (ENABLE_DEBUG_MESSAGES && cursor->data.opcode != OPCODE_NULL)
+        iq_mask pending = cpu->iq.valid_mask;
+        int slot;
+
+        while ((slot = iq_oldest(&cpu->iq, &pending)) >= 0)
         {
-            print_stage_content("Issueq", &cursor->data);
+            iq_mask_clear(&pending, slot);
+            trace_stage(cpu, STAGE_ISSUEQ, &cpu->iq.entry[slot]);
         }
-        cursor = cursor->next;
     }
-    int intfuBusyFlag = 0;
-    int mulfuBusyFlag = 0;
-    int jbuBusyFlag = 0;
-    
 
-    if (count(iqhead) != 0)
+    /*
+     * Each function unit class takes its oldest ready entry. The MUL unit
+     * is not pipelined and takes nothing while busy. Memory ops go first,
+     * a store that finds a violation squashes younger entries before the
+     * other classes select.
+     */
+    for (fu_class = 0; fu_class < IQ_NUM_CLASSES; fu_class++)
     {
+        iq_mask ready;
+        int slot;
 
-        node *cursor = iqhead;
-
-        while (cursor != NULL)
+        if (fu_class == IQ_CLASS_MUL && cpu->mulfu.has_insn)
         {
-            //printf("opcode : %s\n ",cursor->data.opcode_str);
-            switch (cursor->data.opcode)
-            {
-
-            case OPCODE_STR:
-            {
-
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && cpu->pregs_valid[cursor->data.pd])
-                {
-
-                    // printf("PS! : %d",cpu->renameTableValues[cursor->data.ps1]);
-                    // printf("PS2 : %d",cpu->renameTableValues[cursor->data.ps2]);
-                    cpu->mem_valid[cpu->renameTableValues[cursor->data.ps1] + cpu->renameTableValues[cursor->data.ps2]] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 1;
-                    iqhead = remove_any(iqhead, cursor);
-                }
-                break;
-            }
-
-            case OPCODE_STORE:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2])
-                {
-                    cpu->mem_valid[cpu->renameTableValues[cursor->data.ps2] + cpu->renameTableValues[cursor->data.imm]] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 1;
-                    iqhead = remove_any(iqhead, cursor);
-                }
-                break;
-            }
-
-            case OPCODE_LDR:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2])
-                {
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 1;
-                    iqhead = remove_any(iqhead, cursor);
-                }
-                break;
-            }
-
-            case OPCODE_LOAD:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1])
-                {
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 1;
-                    iqhead = remove_any(iqhead, cursor);
-                }
-                break;
-            }
-
-            case OPCODE_CMP:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->intfu = cursor->data;
-                    //printf(" IN here %s",cursor->data.opcode_str);
-                    iqhead = remove_any(iqhead, cursor);
-                    // tmp = enqueue(tmp,cursor->data);
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_ADD:
-            case OPCODE_SUB:
-            case OPCODE_DIV:
-            case OPCODE_AND:
-            case OPCODE_OR:
-            case OPCODE_XOR:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_JUMP:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && jbuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cpu->jbu1 = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    jbuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_JAL:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && jbuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->jbu1 = cursor->data;
-
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    jbuBusyFlag = 1;
-                }
-
-                break;
-            }
-            case OPCODE_BNZ:
-            case OPCODE_BZ:
-            {
-                if (jbuBusyFlag != 1)
-                {
-                    cpu->jbu1 = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    jbuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_MUL:
-            {
-                //printf("MUL STILL IN ISSUEQ\n");
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && mulfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mulfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    mulfuBusyFlag = 1;
-                }
-
-                break;
-            }
-            case OPCODE_ADDL:
-            case OPCODE_SUBL:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_MOVC:
-            {
-                /* MOVC doesn't have register operands */
-                if (intfuBusyFlag != 1)
-                {
-                    cpu->intfu = cursor->data;
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    iqhead = remove_any(iqhead, cursor);
-                    //tmp = enqueue(tmp,cursor->data);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            // case OPCODE_HALT:
-            // {
-            //     cpu->fetch.flush = 1;
-            //     break;
-            // }
-            default:
-            {
-                 iqhead = remove_any(iqhead, cursor);
-                break;
-            }
-            }
-            cursor = cursor->next;
+            continue;
+        }
+        ready = iq_mask_and(&cpu->iq, &cpu->iq.ready_mask, &cpu->iq.class_mask[fu_class]);
+        slot = iq_oldest(&cpu->iq, &ready);
+        if (slot >= 0)
+        {
+            cpu->cycle_activity = TRUE;
+            issue_instruction(cpu, slot);
         }
     }
     cpu->decode.stalled = 0;
@@ -774,12 +995,12 @@ APEX_intfu(APEX_CPU *cpu)
 {
     if (cpu->intfu.flush == 1)
     {
-        strcpy(cpu->intfu.opcode_str, " ");
         cpu->intfu.opcode = 0x0;
         cpu->intfu.pc = 0000;
     }
     if (cpu->intfu.has_insn)
     {
+        cpu->cycle_activity = TRUE;
         /* intfu logic based on instruction type */
         switch (cpu->intfu.opcode)
         {
@@ -787,8 +1008,6 @@ APEX_intfu(APEX_CPU *cpu)
         {
 
             cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
-            cpu->cmpvalue[cpu->intfu.pc] = cpu->intfu.result_buffer;
-            cpu->cmp_completed = 1;
             break;
         }
 
@@ -797,14 +1016,14 @@ APEX_intfu(APEX_CPU *cpu)
 
             cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;  
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_SUB:
         {
             cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
 
             break;
         }
@@ -813,42 +1032,42 @@ APEX_intfu(APEX_CPU *cpu)
         {
             cpu->intfu.result_buffer = cpu->intfu.ps1_value / cpu->intfu.ps2_value;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_AND:
         {
             cpu->intfu.result_buffer = (cpu->intfu.ps1_value) & (cpu->intfu.ps2_value);
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_OR:
         {
             cpu->intfu.result_buffer = cpu->intfu.ps1_value | cpu->intfu.ps2_value;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_XOR:
         {
             cpu->intfu.result_buffer = (cpu->intfu.ps1_value) ^ (cpu->intfu.ps2_value);
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_ADDL:
         {
             cpu->intfu.result_buffer = (cpu->intfu.ps1_value) + cpu->intfu.imm;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
         case OPCODE_SUBL:
         {
             cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.imm;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
 
@@ -857,7 +1076,7 @@ APEX_intfu(APEX_CPU *cpu)
 
             cpu->intfu.result_buffer = cpu->intfu.imm;
             cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            broadcast_tag(cpu, cpu->intfu.pd);
             break;
         }
 
@@ -869,14 +1088,18 @@ APEX_intfu(APEX_CPU *cpu)
         }
         }
 
+        /* The result doubles as the flag value, Z is set when it is 0 */
+        if (sets_flag(cpu->intfu.opcode))
+        {
+            cpu->renameTableValues[cpu->intfu.pf] = cpu->intfu.result_buffer;
+            broadcast_tag(cpu, cpu->intfu.pf);
+        }
+
         /* Copy data from intfu latch to memory latch*/
         // cpu->rob = cpu->intfu;
 
         cpu->intfu.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->intfu.opcode != OPCODE_NULL)
-        {
-            print_stage_content("intfu", &cpu->intfu);
-        }
+        trace_stage(cpu, STAGE_INTFU, &cpu->intfu);
     }
 }
 
@@ -890,7 +1113,6 @@ APEX_mulfu(APEX_CPU *cpu)
 {
     if (cpu->mulfu.flush == 1)
     {
-        strcpy(cpu->mulfu.opcode_str, " ");
         cpu->mulfu.opcode = 0x0;
         cpu->mulfu.pc = 0000;
     }
@@ -898,15 +1120,16 @@ APEX_mulfu(APEX_CPU *cpu)
     if (cpu->mulfu.has_insn)
     {
         cpu->mulstage++;
-        if (cpu->mulstage == 3)
+        if (cpu->mulstage == cpu->config.mul_latency)
         {
+            cpu->cycle_activity = TRUE;
             switch (cpu->mulfu.opcode)
             {
             case OPCODE_MUL:
             {
                 cpu->mulfu.result_buffer = cpu->mulfu.ps1_value * cpu->mulfu.ps2_value;
                 cpu->renameTableValues[cpu->mulfu.pd] = cpu->mulfu.result_buffer;
-                cpu->pregs_valid[cpu->mulfu.pd] = 1;
+                broadcast_tag(cpu, cpu->mulfu.pd);
                 break;
             }
             }
@@ -917,10 +1140,7 @@ APEX_mulfu(APEX_CPU *cpu)
             cpu->mulstage = 0;
         }
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->mulfu.opcode != OPCODE_NULL)
-        {
-            print_stage_content("mulfu", &cpu->mulfu);
-        }
+        trace_stage(cpu, STAGE_MULFU, &cpu->mulfu);
     }
 }
 
@@ -929,51 +1149,70 @@ APEX_jbu1(APEX_CPU *cpu)
 {
     if (cpu->jbu1.flush == 1)
     {
-        strcpy(cpu->jbu1.opcode_str, " ");
         cpu->jbu1.opcode = 0x0;
         cpu->jbu1.pc = 0000;
     }
 
     if (cpu->jbu1.has_insn)
     {
+        cpu->cycle_activity = TRUE;
 
         switch (cpu->jbu1.opcode)
         {
         case OPCODE_BZ:
-
+        case OPCODE_BNZ:
         {
-            if (cpu->zero_flag == 0)
+            /* The outcome is kept in the branch's own ROB entry */
+            CPU_Stage *entry = &cpu->robq.entry[cpu->jbu1.rob_id];
+
+            entry->branch_taken = (cpu->jbu1.ps1_value == 0) == (cpu->jbu1.opcode == OPCODE_BZ);
+            entry->branch_done = TRUE;
+            btb_update(&cpu->btb, cpu->jbu1.pc, cpu->jbu1.pc + cpu->jbu1.imm);
+            predictor_update(&cpu->predictor, cpu->jbu1.pc, cpu->jbu1.pred_history,
+                             entry->branch_taken);
+
+            entry->mispredicted = entry->branch_taken != cpu->jbu1.pred_taken;
+            if (entry->mispredicted)
             {
-                cpu->branch_taken = 1;
+                squash_younger(cpu, &cpu->jbu1, entry->branch_taken ?
+                                                    cpu->jbu1.pc + cpu->jbu1.imm :
+                                                    cpu->jbu1.pc + 4);
             }
             else
             {
-               // cpu->branch_taken = 0;
+                resolve_branch(cpu, cpu->jbu1.checkpoint);
             }
-            cpu->branchcomplete=1;
             break;
         }
 
-        case OPCODE_BNZ:
+        case OPCODE_JUMP:
+        case OPCODE_JAL:
         {
-            if (cpu->zero_flag == 0)
+            /* Fetch went to a BTB or RAS target, or on sequentially */
+            CPU_Stage *entry = &cpu->robq.entry[cpu->jbu1.rob_id];
+            int target = cpu->jbu1.ps1_value + cpu->jbu1.imm;
+
+            if (cpu->jbu1.opcode == OPCODE_JAL)
             {
-               // cpu->branch_taken = 0;
+                cpu->renameTableValues[cpu->jbu1.pd] = cpu->jbu1.pc + 4;
+                broadcast_tag(cpu, cpu->jbu1.pd);
+            }
+            if (!is_return(&cpu->jbu1))
+            {
+                btb_update(&cpu->btb, cpu->jbu1.pc, target);
+            }
+            entry->branch_taken = TRUE;
+            entry->branch_done = TRUE;
 
+            entry->mispredicted = cpu->jbu1.pred_pc != target;
+            if (entry->mispredicted)
+            {
+                squash_younger(cpu, &cpu->jbu1, target);
             }
             else
             {
-                cpu->branch_taken = 1;
+                resolve_branch(cpu, cpu->jbu1.checkpoint);
             }
-            cpu->branchcomplete=1;
-            break;
-        }
-
-        case OPCODE_JUMP:
-        case OPCODE_JAL:
-        {
-            // cpu->jmpjal[cpu->jbu1.pc] = 1;
-            cpu->branch_taken = 1;
             break;
         }
         }
@@ -982,10 +1221,7 @@ APEX_jbu1(APEX_CPU *cpu)
         cpu->jbu2 = cpu->jbu1;
         cpu->jbu1.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->jbu1.opcode != OPCODE_NULL)
-        {
-            print_stage_content("jbu1", &cpu->jbu1);
-        }
+        trace_stage(cpu, STAGE_JBU1, &cpu->jbu1);
     }
 }
 
@@ -994,32 +1230,30 @@ APEX_jbu2(APEX_CPU *cpu)
 {
     if (cpu->jbu2.flush == 1)
     {
-        strcpy(cpu->jbu2.opcode_str, " ");
         cpu->jbu2.opcode = 0x0;
         cpu->jbu2.pc = 0000;
     }
 
     if (cpu->jbu2.has_insn)
     {
+        cpu->cycle_activity = TRUE;
 
         
 
         /* Copy data from jbu1 latch to memory latch*/
         cpu->jbu2.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->jbu2.opcode != OPCODE_NULL)
-        {
-            print_stage_content("jbu2", &cpu->jbu2);
-        }
+        trace_stage(cpu, STAGE_JBU2, &cpu->jbu2);
     }
 }
 
-void validaterob(node *head,APEX_CPU *cpu){
-    node* cursor = head;
-    while(cursor != NULL)
+void validaterob(APEX_CPU *cpu){
+    int k;
+    for (k = 0; k < cpu->robq.count; k++)
     {
-        
-        switch (cursor->data.opcode){
+        CPU_Stage *entry = rob_at(&cpu->robq, k);
+
+        switch (entry->opcode){
         
         case OPCODE_JUMP:
         case OPCODE_BZ:
@@ -1028,26 +1262,20 @@ void validaterob(node *head,APEX_CPU *cpu){
         case OPCODE_NOP:
         case OPCODE_NULL:
         case OPCODE_CMP:
-        {
-            break;
-        }
         case OPCODE_STORE:
+        case OPCODE_STR:
         {
-            cpu->mem_valid[cpu->decode.imm + cpu->renameTableValues[cpu->decode.ps2]] = 1;
-            break;
-        }
-        case OPCODE_STR:{
-            cpu->mem_valid[cpu->renameTableValues[cpu->decode.ps1] + cpu->renameTableValues[cpu->decode.ps2]] = 1;
             break;
         }
         
         default:{
-        cpu->pregs_valid[cursor->data.pd] = 1;
+        broadcast_tag(cpu, entry->pd);
         }
         }
-
-
-        cursor = cursor->next;
+        if (entry->pf >= 0)
+        {
+            broadcast_tag(cpu, entry->pf);
+        }
     }
 }
 
@@ -1062,47 +1290,55 @@ APEX_rob(APEX_CPU *cpu)
 {
     if (cpu->rob.flush == 1)
     {
-        strcpy(cpu->rob.opcode_str, " ");
         cpu->rob.opcode = 0x0;
         cpu->rob.pc = 0000;
     }
 
-    if (count(robhead) != 0)
+    CPU_Stage *head = rob_head(&cpu->robq);
+
+    if (head != NULL)
     {
-        if (robhead->data.opcode == OPCODE_HALT)
+        if (head->opcode == OPCODE_HALT)
         {
-            validaterob(robhead,cpu);
-            cpu->pregs_valid[cpu->issueq.pd] =1;
-            if (ENABLE_DEBUG_MESSAGES && robhead->data.opcode != OPCODE_NULL)
-            {
-                print_stage_content("ROB ", &robhead->data);
-            }
+            validaterob(cpu);
+            broadcast_tag(cpu, cpu->issueq.pd);
+            trace_stage(cpu, STAGE_ROB, head);
             return TRUE;
         }
     }
     if (cpu->rob.opcode != 0x0 && cpu->rob.has_insn == TRUE)
     {
-        robhead = enqueue(robhead, cpu->rob);
+        rob_push(&cpu->robq, &cpu->rob);
+        cpu->cycle_activity = TRUE;
     }
-    node *cursor = robhead;
-    while (cursor != NULL)
+    if (cpu->event_trace || TRACE_STAGE_ON(cpu, STAGE_ROB))
     {
-        if (ENABLE_DEBUG_MESSAGES && cursor->data.opcode != OPCODE_NULL)
+        for (int k = 0; k < cpu->robq.count; k++)
         {
-            print_stage_content("ROB ", &cursor->data);
+            trace_stage(cpu, STAGE_ROB, rob_at(&cpu->robq, k));
         }
-        cursor = cursor->next;
     }
 
     int dequeued = TRUE;
 
-    if (count(robhead) != 0)
+    if (cpu->robq.count != 0)
     {
-        while (robhead != NULL && dequeued)
+        while (cpu->robq.count != 0 && dequeued)
         {
+            head = rob_head(&cpu->robq);
+
+            /* A memory op outside data memory faults once it is the oldest instruction */
+            if (is_memory_op(head->opcode) && head->mem_ready &&
+                !data_address_valid(lsq_at(&cpu->lsq, 0)->addr))
+            {
+                cpu->fault_pc = head->pc;
+                cpu->fault_addr = lsq_at(&cpu->lsq, 0)->addr;
+                return TRUE;
+            }
+
             /* Write result to register file based on instruction type */
             dequeued = FALSE;
-            switch (robhead->data.opcode)
+            switch (head->opcode)
             {
             case OPCODE_ADD:
             case OPCODE_MUL:
@@ -1112,16 +1348,20 @@ APEX_rob(APEX_CPU *cpu)
             case OPCODE_XOR:
             case OPCODE_ADDL:
             {
-                //printf("\nVALUES : %d,%d\n", renameTableValues[robhead->data.pd],cpu->pregs_valid[robhead->data.pd]);
-                if (cpu->pregs_valid[robhead->data.pd])
+                //printf("\nVALUES : %d,%d\n", renameTableValues[head->pd],cpu->pregs_valid[head->pd]);
+                if (cpu->pregs_valid[head->pd])
                 {
-                    //cpu->zero_flag =cpu->renameTableValues[robhead->data.pd];
+                    if (sets_flag(head->opcode))
+                    {
+                        cpu->zero_flag = cpu->renameTableValues[head->pd];
+                        freelist_free(&cpu->fl, head->prev_pf);
+                    }
 
-                    cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                    cpu->regs_valid[robhead->data.rd] = 1;
+                    cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                    cpu->regs_valid[head->rd] = 1;
                     dequeued = TRUE;
-                    phead = enqueueReg(phead,robhead->data.pd);
-                    robhead = dequeue(robhead);
+                    freelist_free(&cpu->fl, head->prev_pd);
+                    rob_pop(&cpu->robq);
                 }
                 // cpu->regs_valid[cpu->intfu.rd] = 0;
                 
@@ -1131,15 +1371,16 @@ APEX_rob(APEX_CPU *cpu)
             case OPCODE_SUB:
             case OPCODE_SUBL:
             {
-                if (cpu->pregs_valid[robhead->data.pd])
+                if (cpu->pregs_valid[head->pd])
                 {
-                    cpu->zero_flag = cpu->renameTableValues[robhead->data.pd];
+                    cpu->zero_flag = cpu->renameTableValues[head->pd];
 
-                    cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                    cpu->regs_valid[robhead->data.rd] = 1;
+                    cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                    cpu->regs_valid[head->rd] = 1;
                     dequeued = TRUE;
-                    phead = enqueueReg(phead,robhead->data.pd);
-                    robhead = dequeue(robhead);
+                    freelist_free(&cpu->fl, head->prev_pd);
+                    freelist_free(&cpu->fl, head->prev_pf);
+                    rob_pop(&cpu->robq);
                 }
                 // cpu->regs_valid[cpu->intfu.rd] = 0;
 
@@ -1148,23 +1389,22 @@ APEX_rob(APEX_CPU *cpu)
 
             case OPCODE_LDR:
             {
-                if (cpu->mreadybit[robhead->data.pc])
+                if (head->mem_ready)
                 {
-                    if (cpu->pregs_valid[robhead->data.pd])
+                    if (cpu->pregs_valid[head->pd])
                     {
-                        cpu->regs[robhead->data.rd] = cpu->data_memory[cpu->renameTableValues[robhead->data.ps1] + cpu->renameTableValues[robhead->data.ps2]];
-                        cpu->regs_valid[robhead->data.rd] = 1;
+                        cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                        cpu->regs_valid[head->rd] = 1;
                         dequeued = TRUE;
-                        phead = enqueueReg(phead,robhead->data.pd);
-                        robhead = dequeue(robhead);
+                        freelist_free(&cpu->fl, head->prev_pd);
+                        cpu->loads++;
+                        cpu->loads_forwarded += lsq_at(&cpu->lsq, 0)->forwarded;
+                        lsq_pop(&cpu->lsq);
+                        rob_pop(&cpu->robq);
                     }
-                    else
+                    else if (!head->mem_issued)
                     {
-
-                        robhead->data.ps1_value = cpu->renameTableValues[robhead->data.ps1];
-                        robhead->data.ps2_value = cpu->renameTableValues[robhead->data.ps2];
-                        cpu->memory1 = robhead->data;
-                        cpu->memory1.has_insn = TRUE;
+                        issue_memory_op(cpu, head);
                     }
                 }
                 break;
@@ -1173,132 +1413,61 @@ APEX_rob(APEX_CPU *cpu)
             case OPCODE_LOAD:
             {
 
-                if (cpu->mreadybit[robhead->data.pc])
+                if (head->mem_ready)
                 {
-                    if (cpu->pregs_valid[robhead->data.pd])
+                    if (cpu->pregs_valid[head->pd])
                     {
-                        cpu->regs[robhead->data.rd] =  cpu->data_memory[cpu->renameTableValues[robhead->data.ps1] + robhead->data.imm];
-                        cpu->regs_valid[robhead->data.rd] = 1;
+                        cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                        cpu->regs_valid[head->rd] = 1;
                         dequeued = TRUE;
-                        phead = enqueueReg(phead,robhead->data.pd);
-                        robhead = dequeue(robhead);
+                        freelist_free(&cpu->fl, head->prev_pd);
+                        cpu->loads++;
+                        cpu->loads_forwarded += lsq_at(&cpu->lsq, 0)->forwarded;
+                        lsq_pop(&cpu->lsq);
+                        rob_pop(&cpu->robq);
                     }
-                    else
+                    else if (!head->mem_issued)
                     {
-
-                        robhead->data.ps1_value = cpu->renameTableValues[robhead->data.ps1];
-                        cpu->memory1 = robhead->data;
-                        cpu->memory1.has_insn = TRUE;
+                        issue_memory_op(cpu, head);
                     }
                 }
                 break;
             }
 
+            /* Branches and jumps already recovered when they resolved in JBU1 */
             case OPCODE_BZ:
             case OPCODE_BNZ:
             {
-                if(cpu->branchcomplete==1){
-                if (cpu->branch_taken == 1)
+                if (head->branch_done)
                 {
-                    // printf("IN BRANCH TAEN");
-                    /* Calculate new PC, and send it to fetch unit */
-                    cpu->pc = robhead->data.imm + robhead->data.pc;
-                    // cpu->decode.has_insn = FALSE;
-                    // cpu->fetch.has_insn = TRUE;
-                    cpu->intfu.flush = 1;
-                    cpu->decode.flush = 1;
-                    cpu->branch_taken = 0;
+                    record_branch(cpu, head);
+                    rob_pop(&cpu->robq);
                     dequeued = TRUE;
-                    //  robhead = dequeue(robhead);
-                    validaterob(robhead,cpu);
-                    dispose(robhead);
-                    robhead = dequeue(robhead);
-                    cpu->rob.flush = 1;
-                    dispose(iqhead);
-                     iqhead = dequeue(iqhead);
-                    cpu->issueq.flush = 1;
-                    cpu->intfu.flush = 1;
-                    cpu->mulfu.flush = 1;
-                    cpu->jbu1.flush=1;
-                   // cpu->jbu2.flush=1;
-                    cpu->memory1.flush = 1;
-                    cpu->memory2.flush = 1;
-                    cpu->branchcomplete=0;
-                }
-                else
-                {
-                     robhead = dequeue(robhead);
-                     dequeued = TRUE;
-                     cpu->branchcomplete=0;
-                }
                 }
-
                 break;
             }
+
             case OPCODE_JUMP:
             {
-                if (cpu->branch_taken == 1)
+                if (head->branch_done)
                 {
-                    // printf("IN BRANCH TAEN");
-                    /* Calculate new PC, and send it to fetch unit */
-                    cpu->pc = robhead->data.imm + cpu->renameTableValues[robhead->data.ps1];
-                    // cpu->decode.has_insn = FALSE;
-                    // cpu->fetch.has_insn = TRUE;
-                    cpu->intfu.flush = 1;
-                    cpu->decode.flush = 1;
-                    cpu->branch_taken = 0;
+                    record_branch(cpu, head);
+                    rob_pop(&cpu->robq);
                     dequeued = TRUE;
-                    validaterob(robhead,cpu);
-                    //  robhead = dequeue(robhead);
-                    dispose(robhead);
-                    robhead = dequeue(robhead);
-
-                    cpu->rob.flush = 1;
-                    dispose(iqhead);
-                     iqhead = dequeue(iqhead);
-                    cpu->issueq.flush = 1;
-                    cpu->intfu.flush = 1;
-                    cpu->mulfu.flush = 1;
-                     cpu->jbu1.flush=1;
-                   // cpu->jbu2.flush=1;
-                    cpu->memory1.flush = 1;
-                    cpu->memory2.flush = 1;
                 }
                 break;
             }
 
             case OPCODE_JAL:
             {
-                if (cpu->branch_taken == 1)
+                if (head->branch_done)
                 {
-                    // printf("IN BRANCH TAEN");
-                    /* Calculate new PC, and send it to fetch unit */
-                    cpu->pc = robhead->data.imm + cpu->renameTableValues[robhead->data.ps1];
-                    cpu->renameTableValues[robhead->data.pd] = robhead->data.pc + 4;
-                    cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                    cpu->regs_valid[robhead->data.rd] = 1;
-
-                    // cpu->decode.has_insn = FALSE;
-                    // cpu->fetch.has_insn = TRUE;
-                    cpu->intfu.flush = 1;
-                    cpu->decode.flush = 1;
-                    cpu->branch_taken = 0;
+                    record_branch(cpu, head);
+                    cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                    cpu->regs_valid[head->rd] = 1;
+                    freelist_free(&cpu->fl, head->prev_pd);
+                    rob_pop(&cpu->robq);
                     dequeued = TRUE;
-                    //  robhead = dequeue(robhead);
-                    validaterob(robhead,cpu);
-
-                    dispose(robhead);
-                    robhead = dequeue(robhead);
-                    cpu->rob.flush = 1;
-                    dispose(iqhead);
-                     iqhead = dequeue(iqhead);
-                    cpu->issueq.flush = 1;
-                    cpu->jbu1.flush=1;
-                    //cpu->jbu2.flush=1;
-                    cpu->intfu.flush = 1;
-                    cpu->mulfu.flush = 1;
-                    cpu->memory1.flush = 1;
-                    cpu->memory2.flush = 1;
                 }
                 break;
             }
@@ -1306,27 +1475,21 @@ APEX_rob(APEX_CPU *cpu)
             case OPCODE_STR:
             {
 
-                if (cpu->mreadybit[robhead->data.pc])
+                /* Stores reach memory here, once they have been through M1 */
+                if (head->mem_ready)
                 {
-                   // if (cpu->mem_valid[robhead->data.ps2_value + robhead->data.ps1_value])
-                    if(cpu->mem_valid[cpu->renameTableValues[robhead->data.ps1] + cpu->renameTableValues[robhead->data.ps2]])
+                    lsq_entry *store = lsq_at(&cpu->lsq, 0);
+
+                    if (store->done)
                     {
-                        //cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                        cpu->data_memory[robhead->data.ps1_value + robhead->data.ps2_value] = cpu->renameTableValues[robhead->data.pd];
-                        //cpu->regs_valid[robhead->data.rd] = 1;
+                        cpu->data_memory[store->addr] = store->data;
                         dequeued = TRUE;
-                        phead = enqueueReg(phead,robhead->data.pd);
-                        robhead = dequeue(robhead);
-                        //  printf("VALUE PASSED1");
+                        lsq_pop(&cpu->lsq);
+                        rob_pop(&cpu->robq);
                     }
-                    else
+                    else if (!head->mem_issued)
                     {
-
-                        robhead->data.ps1_value = cpu->renameTableValues[robhead->data.ps1];
-                        robhead->data.ps2_value = cpu->renameTableValues[robhead->data.ps2];
-                        cpu->memory1 = robhead->data;
-                        cpu->memory1.has_insn = TRUE;
-                        //  printf("VALUE PASSED");
+                        issue_memory_op(cpu, head);
                     }
                 }
                 break;
@@ -1334,28 +1497,20 @@ APEX_rob(APEX_CPU *cpu)
 
             case OPCODE_STORE:
             {
-
-                if (cpu->mreadybit[robhead->data.pc])
+                if (head->mem_ready)
                 {
-                    if (cpu->mem_valid[cpu->renameTableValues[robhead->data.ps2] + robhead->data.imm])
+                    lsq_entry *store = lsq_at(&cpu->lsq, 0);
+
+                    if (store->done)
                     {
-                        //cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                        cpu->data_memory[robhead->data.ps2_value + robhead->data.imm] = cpu->renameTableValues[robhead->data.ps1];
-                        //cpu->regs_valid[robhead->data.rd] = 1;
+                        cpu->data_memory[store->addr] = store->data;
                         dequeued = TRUE;
-                        phead = enqueueReg(phead,robhead->data.pd);
-                        robhead = dequeue(robhead);
-                        cpu->memory1.has_insn = FALSE;
-                        //  printf("VALUE PASSED1");
+                        lsq_pop(&cpu->lsq);
+                        rob_pop(&cpu->robq);
                     }
-                    else
+                    else if (!head->mem_issued)
                     {
-
-                        robhead->data.ps1_value = cpu->renameTableValues[robhead->data.ps1];
-                        robhead->data.ps2_value = cpu->renameTableValues[robhead->data.ps2];
-                        cpu->memory1 = robhead->data;
-                        cpu->memory1.has_insn = TRUE;
-                        //  printf("VALUE PASSED");
+                        issue_memory_op(cpu, head);
                     }
                 }
                 break;
@@ -1363,27 +1518,26 @@ APEX_rob(APEX_CPU *cpu)
 
             case OPCODE_CMP:
             {
-                if (cpu->cmp_completed == 1)
+                if (cpu->pregs_valid[head->pf])
                 {
-                    cpu->zero_flag = cpu->cmpvalue[robhead->data.pc];
+                    cpu->zero_flag = cpu->renameTableValues[head->pf];
                     dequeued = TRUE;
-                    phead = enqueueReg(phead,robhead->data.pd);
-                    robhead = dequeue(robhead);
-                    cpu->cmp_completed = 0;
+                    freelist_free(&cpu->fl, head->prev_pf);
+                    rob_pop(&cpu->robq);
                 }
                 break;
             }
 
             case OPCODE_MOVC:
             {
-                if (cpu->pregs_valid[robhead->data.pd])
+                if (cpu->pregs_valid[head->pd])
                 {
 
-                    cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                    cpu->regs_valid[robhead->data.rd] = 1;
+                    cpu->regs[head->rd] = cpu->renameTableValues[head->pd];
+                    cpu->regs_valid[head->rd] = 1;
                     dequeued = TRUE;
-                    phead = enqueueReg(phead,robhead->data.pd);
-                    robhead = dequeue(robhead);
+                    freelist_free(&cpu->fl, head->prev_pd);
+                    rob_pop(&cpu->robq);
                 }
                 break;
             }
@@ -1396,13 +1550,28 @@ APEX_rob(APEX_CPU *cpu)
             }
             default:
             {
-                robhead = dequeue(robhead);
+                rob_pop(&cpu->robq);
                 dequeued = TRUE;
             }
             }
+
+            if (dequeued)
+            {
+                cpu->cycle_activity = TRUE;
+                cpu->insn_completed++;
+            }
+
+            /* head still points at the retired slot until the next dispatch */
+            if (dequeued && cpu->event_trace)
+            {
+                apex_trace_emit(cpu->event_trace, cpu->clock + 1, TRACE_EVENT_COMMIT, head);
+            }
+            if (dequeued && TRACE_ON(cpu, TRACE_COMMIT))
+            {
+                APEX_print_commit(cpu->clock + 1, head);
+            }
         }
         cpu->decode.stalled = 0;
-        cpu->insn_completed++;
         cpu->rob.has_insn = FALSE;
     }
 
@@ -1420,31 +1589,15 @@ APEX_memory1(APEX_CPU *cpu)
 {
     if (cpu->memory1.has_insn)
     {
+        cpu->cycle_activity = TRUE;
 
         switch (cpu->memory1.opcode)
         {
 
-        case OPCODE_LOAD:
-        case OPCODE_LDR:
-        {
-            cpu->pregs_valid[cpu->memory1.pd] = 1;
-            break;
-        }
-
         case OPCODE_STORE:
-        {
-            // cpu->data_memory[cpu->memory1.result_buffer] = cpu->memory1.rs1_value;
-            // cpu->mem_valid[cpu->memory1.result_buffer] = 1;
-            // cpu->decode.stalled = 0;
-            cpu->mem_valid[cpu->memory1.ps2_value + cpu->memory1.imm] = 1;
-            break;
-        }
         case OPCODE_STR:
         {
-            // cpu->data_memory[cpu->memory1.result_buffer] = cpu->memory1.rd_value;
-            // cpu->mem_valid[cpu->memory1.result_buffer] = 1;
-            // cpu->decode.stalled = 0;
-            cpu->mem_valid[cpu->memory1.ps2_value + cpu->memory1.ps1_value] = 1;
+            cpu->lsq.entry[cpu->memory1.lsq_id].done = TRUE;
             break;
         }
 
@@ -1461,10 +1614,7 @@ APEX_memory1(APEX_CPU *cpu)
 
         cpu->memory1.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->memory1.opcode != OPCODE_NULL)
-        {
-            print_stage_content("Memory1", &cpu->memory1);
-        }
+        trace_stage(cpu, STAGE_MEMORY1, &cpu->memory1);
     }
 }
 /*
@@ -1477,26 +1627,33 @@ APEX_memory2(APEX_CPU *cpu)
 {
     if (cpu->memory2.has_insn)
     {
+        cpu->cycle_activity = TRUE;
 
         switch (cpu->memory2.opcode)
         {
 
         case OPCODE_LDR:
-        {
-
-            cpu->memory2.result_buffer = cpu->memory2.ps1_value + cpu->memory2.ps2_value;
-            cpu->renameTableValues[cpu->memory2.pd] = cpu->data_memory[cpu->memory2.result_buffer];
-            // cpu->regs[cpu->memory2.rd] = cpu->renameTableValues[cpu->memory2.pd];
-            // cpu->regs_valid[cpu->memory2.rd] = 1;
-            // cpu->pregs_valid[cpu->memory2.pd] = 1;
-            break;
-        }
-
         case OPCODE_LOAD:
         {
-            cpu->memory2.result_buffer = cpu->memory2.ps1_value + cpu->memory2.imm;
-            cpu->renameTableValues[cpu->memory2.pd] = cpu->data_memory[cpu->memory2.result_buffer];
-            ;
+            const lsq_entry *load = &cpu->lsq.entry[cpu->memory2.lsq_id];
+            int value = 0;
+
+            /*
+             * A load may be on a wrong path and its address garbage. It
+             * reads 0 from outside data memory, and faults only if it
+             * reaches commit, see APEX_rob.
+             */
+            if (load->forwarded)
+            {
+                value = load->data;
+            }
+            else if (data_address_valid(load->addr))
+            {
+                value = cpu->data_memory[load->addr];
+            }
+            cpu->memory2.result_buffer = load->addr;
+            cpu->renameTableValues[cpu->memory2.pd] = value;
+            broadcast_tag(cpu, cpu->memory2.pd);
             break;
         }
 
@@ -1505,23 +1662,6 @@ APEX_memory2(APEX_CPU *cpu)
         {
             break;
         }
-        case OPCODE_BZ:
-        case OPCODE_BNZ:
-        {
-            if (cpu->branch_taken == 1)
-            {
-
-                /* Calculate new PC, and send it to fetch unit */
-                cpu->pc = cpu->memory2.pc + cpu->memory2.imm;
-                cpu->decode.has_insn = FALSE;
-                cpu->fetch.has_insn = TRUE;
-                cpu->intfu.flush = 1;
-                cpu->decode.flush = 1;
-                cpu->branch_taken = 0;
-            }
-            break;
-        }
-
         case OPCODE_HALT:
         {
             cpu->intfu.flush = 1;
@@ -1534,23 +1674,196 @@ APEX_memory2(APEX_CPU *cpu)
         //cpu->rob = cpu->memory2;
         cpu->memory2.has_insn = FALSE;
 
-        if (ENABLE_DEBUG_MESSAGES && cpu->memory2.opcode != OPCODE_NULL)
+        trace_stage(cpu, STAGE_MEMORY2, &cpu->memory2);
+    }
+}
+
+/*
+ * Memory stages ahead of memory1 when config.mem_depth is above 2. They
+ * only add latency: every op moves one stage per cycle and reaches
+ * memory1 for the next cycle.
+ */
+static void
+APEX_memory_pipe(APEX_CPU *cpu)
+{
+    int last = cpu->config.mem_depth - 3;
+    int i;
+
+    if (last < 0)
+    {
+        return;
+    }
+
+    if (cpu->mem_pipe[last].has_insn)
+    {
+        cpu->memory1 = cpu->mem_pipe[last];
+    }
+    for (i = last; i >= 0; i--)
+    {
+        if (cpu->mem_pipe[i].has_insn)
+        {
+            cpu->cycle_activity = TRUE;
+        }
+        if (i > 0)
+        {
+            cpu->mem_pipe[i] = cpu->mem_pipe[i - 1];
+        }
+    }
+    cpu->mem_pipe[0].has_insn = FALSE;
+}
+
+/*
+ * Early load issue. When the ROB head did not use the memory unit this
+ * cycle, the oldest load that is allowed to pass the older stores still
+ * without an address goes, ahead of its turn at the ROB head: none of
+ * them in LSQ_MODE_OOO, those outside its store set in
+ * LSQ_MODE_STORE_SET. Nothing issues early in LSQ_MODE_HEAD.
+ */
+static void
+APEX_lsq(APEX_CPU *cpu)
+{
+    int id;
+
+    if (cpu->config.lsq_mode == LSQ_MODE_HEAD || memory_entry(cpu)->has_insn)
+    {
+        return;
+    }
+
+    id = lsq_select_load(&cpu->lsq, cpu->config.lsq_mode == LSQ_MODE_STORE_SET);
+    if (id != LSQ_NONE)
+    {
+        issue_memory_op(cpu, &cpu->robq.entry[cpu->lsq.entry[id].rob_id]);
+        cpu->cycle_activity = TRUE;
+    }
+}
+
+/* Frees the structures sized by the config */
+static void
+free_structures(APEX_CPU *cpu)
+{
+    iq_destroy(&cpu->iq);
+    rob_destroy(&cpu->robq);
+    freelist_destroy(&cpu->fl);
+    lsq_destroy(&cpu->lsq);
+    free(cpu->pregs_valid);
+    free(cpu->renameTableValues);
+    free(cpu->mem_pipe);
+    free(cpu->branch_stats);
+}
+
+/*
+ * Puts a CPU back into its power-on state: empty pipeline and out-of-order
+ * structures, zeroed registers and data memory, PC at the first
+ * instruction. The loaded program, the config and the run options (trace
+ * settings, event trace, fast-forward, single step) are kept, so the same
+ * instance can run the program again. Returns FALSE if the structures
+ * could not be allocated.
+ */
+int
+APEX_cpu_reset(APEX_CPU *cpu)
+{
+    APEX_Instruction *code_memory = cpu->code_memory;
+    int code_memory_size = cpu->code_memory_size;
+    APEX_Config config = cpu->config;
+    int single_step = cpu->single_step;
+    int trace_level = cpu->trace_level;
+    unsigned int trace_stages = cpu->trace_stages;
+    struct apex_trace_writer *event_trace = cpu->event_trace;
+    int fast_forward = cpu->fast_forward;
+    int ok, i;
+
+    free_structures(cpu);
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->code_memory = code_memory;
+    cpu->code_memory_size = code_memory_size;
+    cpu->config = config;
+    cpu->single_step = single_step;
+    cpu->trace_level = trace_level;
+    cpu->trace_stages = trace_stages;
+    cpu->event_trace = event_trace;
+    cpu->fast_forward = fast_forward;
+
+    /* Initialize PC, Registers and all pipeline stages */
+    cpu->pc = 4000;
+
+    ok = iq_init(&cpu->iq, config.iq_size, config.pregs + 1);
+    ok &= rob_init(&cpu->robq, config.rob_size);
+    ok &= freelist_init(&cpu->fl, config.pregs);
+    ok &= lsq_init(&cpu->lsq, config.lsq_size);
+    rat_init(&cpu->rat, config.pregs);
+    predictor_init(&cpu->predictor, config.predictor);
+    store_set_init(&cpu->store_sets);
+    cpu->pregs_valid = calloc(config.pregs + 1, sizeof(int));
+    cpu->renameTableValues = calloc(config.pregs + 1, sizeof(int));
+    cpu->mem_pipe = calloc(config.mem_depth, sizeof(CPU_Stage));
+    cpu->branch_stats = calloc(code_memory_size + 1, sizeof(branch_stats));
+    if (!ok || !cpu->pregs_valid || !cpu->renameTableValues || !cpu->mem_pipe ||
+        !cpu->branch_stats)
+    {
+        return FALSE;
+    }
+
+    cpu->zero_flag = -9999;
+    for (i = 0; i < 16; i++)
+    {
+        cpu->regs_valid[i] = 1;
+    }
+    /* Unmapped architectural registers read the extra slot, always valid */
+    for (i = 0; i <= config.pregs; i++)
+    {
+        cpu->pregs_valid[i] = 1;
+    }
+
+    /* To start fetch stage */
+    cpu->fetch.has_insn = TRUE;
+    return TRUE;
+}
+
+/*
+ * Hands architectural state left by APEX_func_run to the out-of-order
+ * core, which must still be in its reset state. Every register holding a
+ * non-zero value is mapped to a physical register of its own, taken from
+ * the free list and marked valid. The others stay unmapped and read the
+ * spare slot, which is always 0, and so does the Z flag, which reads
+ * zero_flag. Fetch starts at cpu->pc. Returns FALSE if that would leave
+ * the free list empty.
+ */
+int
+APEX_cpu_enter_detailed(APEX_CPU *cpu)
+{
+    int i;
+
+    for (i = 0; i < REG_FILE_SIZE; i++)
+    {
+        int preg;
+
+        if (cpu->regs[i] == 0)
+        {
+            continue;
+        }
+        preg = freelist_alloc(&cpu->fl);
+        if (preg < 0)
         {
-            print_stage_content("Memory2", &cpu->memory2);
+            return FALSE;
         }
+        rat_rename(&cpu->rat, i, preg);
+        cpu->renameTableValues[preg] = cpu->regs[i];
+        cpu->pregs_valid[preg] = 1;
     }
+    return !freelist_empty(&cpu->fl);
 }
 
 /*
- * This function creates and initializes APEX cpu.
+ * This function creates and initializes APEX cpu. Every CPU owns all of
+ * its state, so several can be simulated in one process, each from a
+ * single thread at a time. A NULL config selects the defaults in
+ * apex_macros.h.
  *
  * Note: You are free to edit this function according to your implementation
  */
 APEX_CPU *
-APEX_cpu_init(const char *filename)
+APEX_cpu_init(const char *filename, const APEX_Config *config)
 {
-
-    int i;
     APEX_CPU *cpu;
 
     if (!filename)
@@ -1565,42 +1878,19 @@ APEX_cpu_init(const char *filename)
         return NULL;
     }
 
-    /* Initialize PC, Registers and all pipeline stages */
-    cpu->pc = 4000;
-    memset(cpu->regs, 0, sizeof(int) * REG_FILE_SIZE);
-    memset(cpu->renameTableValues, 0, sizeof(int) * (PREGS_FILE_SIZE+1));
-
-    iqhead = NULL;
-    robhead = NULL;
-    phead = NULL;
-    rfprf = NULL;
-
-    tmp = NULL;
-    memset(cpu->data_memory, 0, sizeof(int) * DATA_MEMORY_SIZE);
-    memset(cpu->mreadybit, 0, sizeof(int) * 60000);
-    memset(cpu->cmpvalue, 0, sizeof(int) * 60000);
-    for (i = 0; i < 4096; i++)
+    if (config)
     {
-        cpu->mem_valid[i] = 1;
+        cpu->config = *config;
     }
-    cpu->zero_flag = -9999;
-    cpu->branch_taken = 0;
-    cpu->cmp_completed = 0;
-    cpu->mulstage = 0;
-    cpu->branchcomplete = 0;
-    // cpu->data_memory[124031] = 1;
-    for (i = 0; i < 16; i++)
+    else
     {
-        cpu->regs_valid[i] = 1;
+        APEX_config_default(&cpu->config);
     }
-    for (i = 0; i < 48; i++)
-    {                  
-        cpu->pregs_valid[i] = 1;
-        phead = enqueueReg(phead, i);
+    if (APEX_config_check(&cpu->config))
+    {
+        free(cpu);
+        return NULL;
     }
-    
-
-    cpu->single_step = ENABLE_SINGLE_STEP;
 
     /* Parse input file and create code memory */
     cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
@@ -1610,27 +1900,16 @@ APEX_cpu_init(const char *filename)
         return NULL;
     }
 
-    if (ENABLE_DEBUG_MESSAGES)
+    cpu->single_step = ENABLE_SINGLE_STEP;
+    cpu->trace_level = APEX_TRACE_MAX;
+    cpu->trace_stages = TRACE_ALL_STAGES;
+    cpu->fast_forward = FALSE;
+    if (!APEX_cpu_reset(cpu))
     {
-        fprintf(stderr,
-                "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
-                cpu->code_memory_size);
-        fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
-        fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
-        printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
-               "imm");
-
-        for (i = 0; i < cpu->code_memory_size; ++i)
-        {
-            printf("%-9s %-9d %-9d %-9d %-9d\n", cpu->code_memory[i].opcode_str,
-                   cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
-                   cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
-        }
+        APEX_cpu_stop(cpu);
+        return NULL;
     }
 
-    /* To start fetch stage */
-    cpu->fetch.has_insn = TRUE;
-
     return cpu;
 }
 
@@ -1642,7 +1921,7 @@ void printFile(APEX_CPU *cpu)
     printf("|Ar Register|Phy. Register| Value | VALID bit\n");
     for (int i = 0; i < 16; i++)
     {
-        printf("|R[%d]\t|\tP[%d]\t|\t=%d\t|\t%d\n",i,searchprftop1(rfprf, i),cpu->renameTableValues[searchprftop(rfprf, i)],cpu->pregs_valid[searchprftop1(rfprf, i)] );
+        printf("|R[%d]\t|\tP[%d]\t|\t=%d\t|\t%d\n",i,rat_mapping(&cpu->rat, i),cpu->renameTableValues[rat_lookup(&cpu->rat, i)],cpu->pregs_valid[rat_lookup(&cpu->rat, i)] );
     }
     printf("\n-----------------REGISTER FILE------------------------------------------------------- \n");
 
@@ -1663,6 +1942,31 @@ void printFile(APEX_CPU *cpu)
     printf("-----------------DATA MEMORY-------------- \n");
 }
 
+/*
+ * Prints the parsed code memory, done by the interactive front end right
+ * after the CPU is initialized
+ */
+void
+APEX_print_code_memory(const APEX_CPU *cpu)
+{
+    int i;
+
+    fprintf(stderr,
+            "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
+            cpu->code_memory_size);
+    fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
+    fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
+    printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
+           "imm");
+
+    for (i = 0; i < cpu->code_memory_size; ++i)
+    {
+        printf("%-9s %-9d %-9d %-9d %-9d\n", APEX_opcode_name(cpu->code_memory[i].opcode),
+               cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
+               cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
+    }
+}
+
 /*
  * APEX CPU simulation loop
  *
@@ -1725,11 +2029,52 @@ void APEX_cpu_run(APEX_CPU *cpu, int x, int y)
     }
 }
 
+/*
+ * Idle-cycle skipping. A cycle in which no stage did any work (see
+ * cycle_activity) leaves the machine unchanged apart from the MUL
+ * countdown, so every following cycle repeats it until the MUL unit
+ * completes. Those cycles are accounted for in one step instead of being
+ * simulated: the clock and the countdown move forward together, and the
+ * completing cycle runs normally. Nothing retires in a skipped cycle.
+ */
+static void
+skip_idle_cycles(APEX_CPU *cpu)
+{
+    long skip;
+
+    if (cpu->cycle_activity || !cpu->mulfu.has_insn)
+    {
+        return;
+    }
+
+    skip = cpu->config.mul_latency - 1 - cpu->mulstage;
+    if (cpu->cycle_limit > 0 && cpu->clock + skip > cpu->cycle_limit)
+    {
+        skip = cpu->cycle_limit - cpu->clock;
+    }
+    if (skip <= 0)
+    {
+        return;
+    }
+
+    cpu->clock += skip;
+    cpu->mulstage += skip;
+    cpu->cycles_skipped += skip;
+
+    /* Decode is held on the same resource in every skipped cycle */
+    if (cpu->stall_cause != STALL_NONE)
+    {
+        cpu->stalls[cpu->stall_cause] += skip;
+    }
+}
+
 int APEX_run_at_choice(APEX_CPU *cpu, int z)
 {
     int breaker = 0;
     char user_prompt_val;
-    if (ENABLE_DEBUG_MESSAGES)
+
+    cpu->cycle_activity = FALSE;
+    if (TRACE_ON(cpu, TRACE_STAGE))
     {
         printf("--------------------------------------------\n");
         printf("Clock Cycle #: %d\n", cpu->clock + 1);
@@ -1741,19 +2086,33 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
 
     if (APEX_rob(cpu))
     {
+        if (cpu->fault_pc)
+        {
+            fprintf(stderr, "APEX_Error: pc(%d) accesses MEM[%d], outside data memory\n",
+                    cpu->fault_pc, cpu->fault_addr);
+        }
         /* Halt in rob stage */
-        printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock + 1, cpu->insn_completed);
+        else if (TRACE_ON(cpu, TRACE_COMMIT))
+        {
+            printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock + 1, cpu->insn_completed);
+        }
+        cpu->clock++;
         return 1;
     }
+    APEX_lsq(cpu);
     APEX_jbu2(cpu);
     APEX_jbu1(cpu);
     APEX_memory2(cpu);
     APEX_memory1(cpu);
+    APEX_memory_pipe(cpu);
     APEX_issueq(cpu);
     APEX_decode(cpu);
     APEX_fetch(cpu);
 
-    print_reg_file(cpu);
+    if (TRACE_ON(cpu, TRACE_FULL))
+    {
+        print_reg_file(cpu);
+    }
     
 
     if (cpu->single_step && z == 0)
@@ -1769,17 +2128,99 @@ int APEX_run_at_choice(APEX_CPU *cpu, int z)
     }
 
     cpu->clock++;
+    if (cpu->fast_forward)
+    {
+        skip_idle_cycles(cpu);
+    }
     return breaker;
 }
 
 /*
- * This function deallocates APEX CPU.
+ * Headless run used by --run-to-halt. Steps the pipeline without prompting
+ * until HALT commits, a memory op faults or max_cycles (0 = no limit) have
+ * elapsed. With fast_forward, idle cycles are skipped unless a per-cycle
+ * trace is being written. Interactive runs never skip them.
+ * Returns APEX_HALTED, APEX_FAULT or APEX_CYCLE_LIMIT.
+ */
+int
+APEX_cpu_run_to_halt(APEX_CPU *cpu, long max_cycles, int fast_forward)
+{
+    /* Skipped cycles would be missing from a per-cycle trace */
+    cpu->fast_forward = fast_forward && !cpu->event_trace && !TRACE_ON(cpu, TRACE_STAGE);
+    cpu->cycle_limit = max_cycles;
+    while (!APEX_run_at_choice(cpu, 1))
+    {
+        if (max_cycles > 0 && cpu->clock >= max_cycles)
+        {
+            return APEX_CYCLE_LIMIT;
+        }
+    }
+    return cpu->fault_pc ? APEX_FAULT : APEX_HALTED;
+}
+
+/* Final summary printed after a headless run */
+void
+APEX_print_summary(const APEX_CPU *cpu)
+{
+    int i;
+
+    printf("APEX_CPU: cycles = %d instructions = %d IPC = %.3f\n", cpu->clock,
+           cpu->insn_completed,
+           cpu->clock ? (double)cpu->insn_completed / cpu->clock : 0.0);
+    if (cpu->func_insns)
+    {
+        printf("Skipped: instructions = %ld run functionally before the first cycle\n",
+               cpu->func_insns);
+    }
+    printf("Decode stalls:");
+    for (i = 0; i < NUM_STALL_CAUSES; i++)
+    {
+        printf(" %s = %d", APEX_stall_name(i), cpu->stalls[i]);
+    }
+    printf("\n");
+    printf("Branches: predictor = %s executed = %d mispredicts = %d (%.2f%%)\n",
+           predictor_names[cpu->config.predictor], cpu->branch_totals.executed,
+           cpu->branch_totals.mispredicts,
+           cpu->branch_totals.executed ?
+               100.0 * cpu->branch_totals.mispredicts / cpu->branch_totals.executed : 0.0);
+    printf("Jumps: executed = %d mispredicts = %d\n", cpu->jump_totals.executed,
+           cpu->jump_totals.mispredicts);
+    printf("Loads: lsq_mode = %s executed = %d forwarded = %d replays = %d\n",
+           lsq_mode_names[cpu->config.lsq_mode], cpu->loads, cpu->loads_forwarded,
+           cpu->load_replays);
+    for (i = 0; i < REG_FILE_SIZE; i++)
+    {
+        printf("R%d=%d%s", i, cpu->regs[i], i == REG_FILE_SIZE - 1 ? "\n" : " ");
+    }
+    for (i = 0; i < cpu->code_memory_size; i++)
+    {
+        const branch_stats *stats = &cpu->branch_stats[i];
+
+        if (stats->executed)
+        {
+            printf("Branch pc(%d) %s: executed = %d btb_hits = %d mispredicts = %d\n",
+                   4000 + 4 * i, APEX_opcode_name(cpu->code_memory[i].opcode),
+                   stats->executed, stats->btb_hits, stats->mispredicts);
+        }
+    }
+    for (i = 0; i < DATA_MEMORY_SIZE; i++)
+    {
+        if (cpu->data_memory[i] != 0)
+        {
+            printf("MEM[%d]=%d\n", i, cpu->data_memory[i]);
+        }
+    }
+}
+
+/*
+ * This function deallocates APEX CPU, closing its event trace.
  *
  * Note: You are free to edit this function according to your implementation
  */
 void APEX_cpu_stop(APEX_CPU *cpu)
 {
+    apex_trace_close(cpu->event_trace);
+    free_structures(cpu);
     free(cpu->code_memory);
     free(cpu);
-
 }
\ No newline at end of file
@@ -10,73 +10,71 @@
 #define _APEX_CPU_H_
 
 #include "apex_macros.h"
+#include "apex_config.h"
+#include "apex_stage.h"
+#include "issuequeue.h"
+#include "reorderbuffer.h"
+#include "renametable.h"
+#include "freelist.h"
+#include "btb.h"
+#include "predictor.h"
+#include "ras.h"
+#include "lsq.h"
+#include "storeset.h"
 
-/* Format of an APEX instruction  */
-typedef struct APEX_Instruction
-{
-    char opcode_str[128];
-    int opcode;
-    int rd;
-    int rs1;
-    int rs2;
-    int imm;
-} APEX_Instruction;
-
-/* Model of CPU stage latch */
-typedef struct CPU_Stage
-{
-    int trial;
-    int pc;
-    char opcode_str[128];
-    int opcode;
-    int rs1;
-    int rs2;
-    int rd;
-    int ps1;
-    int ps2;
-    int pd;
-    int imm;
-    int rs1_value;
-    int rs2_value;
-    int rd_value;
-    int ps1_value;
-    int ps2_value;
-    int result_buffer;
-    int memory_address;
-    int has_insn;
-    int stalled;
-    int flush;
-    int instype;
-
-    //int zero_flag;
-
-} CPU_Stage;
+/* APEX_cpu_run_to_halt results, also apex_sim's exit status */
+#define APEX_HALTED 0
+#define APEX_FAULT 1       /* A load or store outside data memory reached commit */
+#define APEX_CYCLE_LIMIT 2
 
 /* Model of APEX CPU */
 typedef struct APEX_CPU
 {
+    APEX_Config config;      /* Structure sizes and latencies, fixed at init */
     int pc;                  /* Current program counter */
     int clock;               /* Clock cycles elapsed */
     int insn_completed;      /* Instructions retired */
+    long func_insns;         /* Run by apex_func.c before the detailed core took over */
     int regs[REG_FILE_SIZE]; /* Integer register file */
     int regs_valid[REG_FILE_SIZE];
-    int pregs_valid[PREGS_FILE_SIZE];
-    int mem_valid[4096];
+    int *pregs_valid;             /* config.pregs + 1 entries, see rat_lookup */
     int code_memory_size;              /* Number of instruction in the input file */
     APEX_Instruction *code_memory;     /* Code Memory */
     int data_memory[DATA_MEMORY_SIZE]; /* Data Memory */
     int single_step;                   /* Wait for user input after every cycle */
-    int zero_flag;                     /* {TRUE, FALSE} Used by BZ and BNZ to branch */
+    int trace_level;                   /* TRACE_OFF .. TRACE_FULL, see apex_macros.h */
+    unsigned int trace_stages;         /* Stages printed at TRACE_STAGE and above */
+    struct apex_trace_writer *event_trace; /* Binary event trace, NULL when off */
+    int zero_flag;                     /* Committed flag value, Z is set when it is 0 */
     int fetch_from_next_cycle;
-    int renameTableValues[PREGS_FILE_SIZE+1];
-    int branch_taken;
-    int cmp_completed; 
+    int *renameTableValues;       /* Physical register values, config.pregs + 1 */
     int mulstage;
-    int mreadybit[60000];
-    int cmpvalue[60000];
     int intbusy;
     int mulbusy;
-    int branchcomplete;
+    int cycle_activity;  /* Set by any stage that does work in the current cycle */
+    int fast_forward;    /* Skip idle cycles, only set by APEX_cpu_run_to_halt */
+    long cycle_limit;    /* Skipping never passes this cycle, 0 = no limit */
+    long cycles_skipped; /* Idle cycles accounted for without simulating them */
+    int fault_pc;        /* Memory op that committed outside data memory, 0 if none */
+    int fault_addr;      /* Its address */
+    int stall_cause;     /* STALL_* that held decode this cycle */
+    int stalls[NUM_STALL_CAUSES]; /* Cycles decode was held, by cause */
+    /* Out-of-order structures */
+    issue_queue iq;
+    reorder_buffer robq;
+    rename_table rat;
+    free_list fl;
+    load_store_queue lsq;
+    store_set_table store_sets;
+    branch_target_buffer btb;
+    branch_predictor predictor;
+    return_stack ras;
+    branch_stats *branch_stats; /* One per code memory entry */
+    branch_stats branch_totals; /* Sum over all BZ and BNZ */
+    branch_stats jump_totals;   /* Sum over all JAL and JUMP */
+    int loads;           /* LOAD and LDR committed */
+    int loads_forwarded; /* Of those, served by an older store in the LSQ */
+    int load_replays;    /* Loads squashed by a memory order violation */
     /* Pipeline stages */
     CPU_Stage fetch;
     CPU_Stage decode;
@@ -86,6 +84,7 @@ typedef struct APEX_CPU
     CPU_Stage rob;
     CPU_Stage jbu1;
     CPU_Stage jbu2;
+    CPU_Stage *mem_pipe;     /* config.mem_depth - 2 stages ahead of memory1 */
     CPU_Stage memory1;
     CPU_Stage memory2;
 } APEX_CPU;
@@ -94,8 +93,23 @@ typedef struct APEX_CPU
 
 
 APEX_Instruction *create_code_memory(const char *filename, int *size);
-APEX_CPU *APEX_cpu_init(const char *filename);
+APEX_CPU *APEX_cpu_init(const char *filename, const APEX_Config *config);
+int APEX_cpu_reset(APEX_CPU *cpu);
+int APEX_cpu_enter_detailed(APEX_CPU *cpu);
 void APEX_cpu_run(APEX_CPU *cpu, int x, int y);
 int APEX_run_at_choice(APEX_CPU *cpu, int z);
+int APEX_cpu_run_to_halt(APEX_CPU *cpu, long max_cycles, int fast_forward);
+void APEX_print_code_memory(const APEX_CPU *cpu);
+void APEX_print_summary(const APEX_CPU *cpu);
 void APEX_cpu_stop(APEX_CPU *cpu);
+
+/* apex_func.c */
+long APEX_func_run(APEX_CPU *cpu, long max_insns, int stop_pc);
+long APEX_func_run_switch(APEX_CPU *cpu, long max_insns, int stop_pc);
+
+/* apex_print.c */
+const char *APEX_opcode_name(int opcode);
+const char *APEX_stall_name(int cause);
+void APEX_print_stage(int stage_id, const CPU_Stage *stage);
+void APEX_print_commit(int cycle, const CPU_Stage *stage);
 #endif
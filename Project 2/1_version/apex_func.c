@@ -0,0 +1,393 @@
+/*
+ * apex_func.c
+ * Functional APEX interpreter used to fast-forward to a region of interest
+ *
+ * Instructions are executed one at a time straight on the architectural
+ * state, regs, data_memory, the Z flag value and the PC, with no pipeline,
+ * renaming or timing. Nothing else in APEX_CPU is touched, so once it
+ * stops, APEX_cpu_enter_detailed can set up the out-of-order core to carry
+ * on from the same point. Results and the flag follow the detailed core's
+ * rules, see APEX_intfu and APEX_rob: CMP, ADD, ADDL, SUB and SUBL leave
+ * their result as the flag value, and Z is set when it is 0. A load or
+ * store outside data memory is not executed, the run stops in front of it
+ * and the detailed core then reports the fault.
+ *
+ * There are two interpreters with the same behaviour. The plain one
+ * decodes code_memory with a switch for every instruction. The threaded
+ * one, used by default with GCC and Clang, first translates the program
+ * into an array of func_op, one per instruction. Each op holds the address
+ * of its handler and its operands, with a branch target already turned
+ * into an op index. Every handler then jumps straight to the next op's
+ * handler with a computed goto, so there is no central dispatch branch.
+ * apex_funcbench compares the two.
+ */
+#include <stdlib.h>
+#include "apex_cpu.h"
+
+/* Code memory index of pc, or -1 outside code memory or between instructions */
+static int
+code_index(const APEX_CPU *cpu, int pc)
+{
+    int offset = pc - 4000;
+
+    if (offset < 0 || offset % 4 || offset / 4 >= cpu->code_memory_size)
+    {
+        return -1;
+    }
+    return offset / 4;
+}
+
+/* FALSE for a load or store whose address is outside data memory */
+static int
+access_valid(const int *regs, const APEX_Instruction *ins)
+{
+    switch (ins->opcode)
+    {
+    case OPCODE_LOAD:
+        return data_address_valid(regs[ins->rs1] + ins->imm);
+    case OPCODE_STORE:
+        return data_address_valid(regs[ins->rs2] + ins->imm);
+    case OPCODE_LDR:
+    case OPCODE_STR:
+        return data_address_valid(regs[ins->rs1] + regs[ins->rs2]);
+    default:
+        return TRUE;
+    }
+}
+
+/*
+ * Runs from cpu->pc until max_insns instructions have executed (0 = no
+ * limit), the PC reaches stop_pc (-1 = none) or leaves code memory, or the
+ * next instruction is HALT or a load or store outside data memory. The
+ * instruction at the stopping point is not executed. Returns the number of instructions executed, which is also
+ * added to cpu->func_insns.
+ */
+long
+APEX_func_run_switch(APEX_CPU *cpu, long max_insns, int stop_pc)
+{
+    const APEX_Instruction *code = cpu->code_memory;
+    int *regs = cpu->regs;
+    int *mem = cpu->data_memory;
+    int pc = cpu->pc;
+    int flag = cpu->zero_flag;
+    long count = 0;
+
+    while (max_insns == 0 || count < max_insns)
+    {
+        const APEX_Instruction *ins;
+        int index = code_index(cpu, pc);
+
+        if (pc == stop_pc || index < 0)
+        {
+            break;
+        }
+        ins = &code[index];
+        if (ins->opcode == OPCODE_HALT || !access_valid(regs, ins))
+        {
+            break;
+        }
+        pc += 4;
+
+        switch (ins->opcode)
+        {
+        case OPCODE_ADD:
+            flag = regs[ins->rd] = regs[ins->rs1] + regs[ins->rs2];
+            break;
+        case OPCODE_SUB:
+            flag = regs[ins->rd] = regs[ins->rs1] - regs[ins->rs2];
+            break;
+        case OPCODE_MUL:
+            regs[ins->rd] = regs[ins->rs1] * regs[ins->rs2];
+            break;
+        case OPCODE_DIV:
+            regs[ins->rd] = regs[ins->rs1] / regs[ins->rs2];
+            break;
+        case OPCODE_AND:
+            regs[ins->rd] = regs[ins->rs1] & regs[ins->rs2];
+            break;
+        case OPCODE_OR:
+            regs[ins->rd] = regs[ins->rs1] | regs[ins->rs2];
+            break;
+        case OPCODE_XOR:
+            regs[ins->rd] = regs[ins->rs1] ^ regs[ins->rs2];
+            break;
+        case OPCODE_ADDL:
+            flag = regs[ins->rd] = regs[ins->rs1] + ins->imm;
+            break;
+        case OPCODE_SUBL:
+            flag = regs[ins->rd] = regs[ins->rs1] - ins->imm;
+            break;
+        case OPCODE_MOVC:
+            regs[ins->rd] = ins->imm;
+            break;
+        case OPCODE_CMP:
+            flag = regs[ins->rs1] - regs[ins->rs2];
+            break;
+        case OPCODE_LOAD:
+            regs[ins->rd] = mem[regs[ins->rs1] + ins->imm];
+            break;
+        case OPCODE_LDR:
+            regs[ins->rd] = mem[regs[ins->rs1] + regs[ins->rs2]];
+            break;
+        case OPCODE_STORE:
+            mem[regs[ins->rs2] + ins->imm] = regs[ins->rs1];
+            break;
+        case OPCODE_STR:
+            mem[regs[ins->rs1] + regs[ins->rs2]] = regs[ins->rd];
+            break;
+        case OPCODE_BZ:
+            if (flag == 0)
+            {
+                pc += ins->imm - 4;
+            }
+            break;
+        case OPCODE_BNZ:
+            if (flag != 0)
+            {
+                pc += ins->imm - 4;
+            }
+            break;
+        case OPCODE_JUMP:
+            pc = regs[ins->rs1] + ins->imm;
+            break;
+        case OPCODE_JAL:
+        {
+            /* The target is read before the link register is written */
+            int target = regs[ins->rs1] + ins->imm;
+
+            regs[ins->rd] = pc;
+            pc = target;
+            break;
+        }
+        default:
+            break;
+        }
+        count++;
+    }
+
+    cpu->pc = pc;
+    cpu->zero_flag = flag;
+    cpu->func_insns += count;
+    return count;
+}
+
+#if defined(__GNUC__)
+
+/* One translated instruction */
+typedef struct func_op
+{
+    const void *handler;
+    int rd;
+    int rs1;
+    int rs2;
+    int imm;
+    int target; /* BZ and BNZ: op index of the taken target, -1 if outside code memory */
+} func_op;
+
+/*
+ * Threaded-code version of APEX_func_run_switch. The op after the last
+ * instruction, HALT and the op at stop_pc all run the exit handler, and
+ * so does a load or store that finds its address outside data memory. The
+ * instruction limit is checked as each op is dispatched, and the exit
+ * handler takes back the count it was given.
+ */
+long
+APEX_func_run(APEX_CPU *cpu, long max_insns, int stop_pc)
+{
+    static const void *const handlers[] = {
+        [OPCODE_NULL] = &&op_nop, [OPCODE_SUB] = &&op_sub,   [OPCODE_MUL] = &&op_mul,
+        [OPCODE_DIV] = &&op_div,  [OPCODE_AND] = &&op_and,   [OPCODE_OR] = &&op_or,
+        [OPCODE_XOR] = &&op_xor,  [OPCODE_MOVC] = &&op_movc, [OPCODE_LOAD] = &&op_load,
+        [OPCODE_STORE] = &&op_store, [OPCODE_BZ] = &&op_bz,  [OPCODE_BNZ] = &&op_bnz,
+        [OPCODE_HALT] = &&op_exit, [OPCODE_SUBL] = &&op_subl, [OPCODE_ADDL] = &&op_addl,
+        [OPCODE_ADD] = &&op_add,  [OPCODE_STR] = &&op_str,   [OPCODE_LDR] = &&op_ldr,
+        [OPCODE_CMP] = &&op_cmp,  [OPCODE_NOP] = &&op_nop,   [OPCODE_JAL] = &&op_jal,
+        [OPCODE_JUMP] = &&op_jump};
+    const int num_handlers = sizeof(handlers) / sizeof(handlers[0]);
+    int size = cpu->code_memory_size;
+    int *regs = cpu->regs;
+    int *mem = cpu->data_memory;
+    int flag = cpu->zero_flag;
+    long limit = max_insns ? max_insns : -1;
+    long count = 0;
+    func_op *ops;
+    const func_op *op;
+    int i, pc, stop, addr;
+
+    i = code_index(cpu, cpu->pc);
+    if (i < 0)
+    {
+        return 0;
+    }
+    ops = malloc((size + 1) * sizeof(func_op));
+    if (!ops)
+    {
+        return APEX_func_run_switch(cpu, max_insns, stop_pc);
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        const APEX_Instruction *ins = &cpu->code_memory[i];
+        int opcode = ins->opcode;
+
+        ops[i].handler = opcode < num_handlers && handlers[opcode] ? handlers[opcode] : &&op_nop;
+        ops[i].rd = ins->rd;
+        ops[i].rs1 = ins->rs1;
+        ops[i].rs2 = ins->rs2;
+        ops[i].imm = ins->imm;
+        ops[i].target = code_index(cpu, 4000 + 4 * i + ins->imm);
+    }
+    ops[size].handler = &&op_exit;
+    stop = code_index(cpu, stop_pc);
+    if (stop >= 0)
+    {
+        ops[stop].handler = &&op_exit;
+    }
+
+#define DISPATCH()                 \
+    do                             \
+    {                              \
+        if (count++ == limit)      \
+        {                          \
+            goto op_exit;          \
+        }                          \
+        goto *op->handler;         \
+    } while (0)
+#define NEXT() \
+    op++;      \
+    DISPATCH()
+#define OP_PC(o) (4000 + 4 * (int)((o) - ops))
+
+    op = &ops[code_index(cpu, cpu->pc)];
+    DISPATCH();
+
+op_add:
+    flag = regs[op->rd] = regs[op->rs1] + regs[op->rs2];
+    NEXT();
+op_sub:
+    flag = regs[op->rd] = regs[op->rs1] - regs[op->rs2];
+    NEXT();
+op_mul:
+    regs[op->rd] = regs[op->rs1] * regs[op->rs2];
+    NEXT();
+op_div:
+    regs[op->rd] = regs[op->rs1] / regs[op->rs2];
+    NEXT();
+op_and:
+    regs[op->rd] = regs[op->rs1] & regs[op->rs2];
+    NEXT();
+op_or:
+    regs[op->rd] = regs[op->rs1] | regs[op->rs2];
+    NEXT();
+op_xor:
+    regs[op->rd] = regs[op->rs1] ^ regs[op->rs2];
+    NEXT();
+op_addl:
+    flag = regs[op->rd] = regs[op->rs1] + op->imm;
+    NEXT();
+op_subl:
+    flag = regs[op->rd] = regs[op->rs1] - op->imm;
+    NEXT();
+op_movc:
+    regs[op->rd] = op->imm;
+    NEXT();
+op_cmp:
+    flag = regs[op->rs1] - regs[op->rs2];
+    NEXT();
+op_load:
+    addr = regs[op->rs1] + op->imm;
+    if (!data_address_valid(addr))
+    {
+        goto op_exit;
+    }
+    regs[op->rd] = mem[addr];
+    NEXT();
+op_ldr:
+    addr = regs[op->rs1] + regs[op->rs2];
+    if (!data_address_valid(addr))
+    {
+        goto op_exit;
+    }
+    regs[op->rd] = mem[addr];
+    NEXT();
+op_store:
+    addr = regs[op->rs2] + op->imm;
+    if (!data_address_valid(addr))
+    {
+        goto op_exit;
+    }
+    mem[addr] = regs[op->rs1];
+    NEXT();
+op_str:
+    addr = regs[op->rs1] + regs[op->rs2];
+    if (!data_address_valid(addr))
+    {
+        goto op_exit;
+    }
+    mem[addr] = regs[op->rd];
+    NEXT();
+op_nop:
+    NEXT();
+op_bz:
+    if (flag != 0)
+    {
+        NEXT();
+    }
+    goto branch_taken;
+op_bnz:
+    if (flag == 0)
+    {
+        NEXT();
+    }
+branch_taken:
+    if (op->target < 0)
+    {
+        pc = OP_PC(op) + op->imm;
+        goto done;
+    }
+    op = &ops[op->target];
+    DISPATCH();
+op_jal:
+{
+    /* The target is read before the link register is written */
+    int target = regs[op->rs1] + op->imm;
+
+    regs[op->rd] = OP_PC(op) + 4;
+    pc = target;
+    goto jump;
+}
+op_jump:
+    pc = regs[op->rs1] + op->imm;
+jump:
+    i = code_index(cpu, pc);
+    if (i < 0)
+    {
+        goto done;
+    }
+    op = &ops[i];
+    DISPATCH();
+
+op_exit:
+    /* Reached without executing anything */
+    count--;
+    pc = OP_PC(op);
+done:
+#undef DISPATCH
+#undef NEXT
+#undef OP_PC
+    free(ops);
+    cpu->pc = pc;
+    cpu->zero_flag = flag;
+    cpu->func_insns += count;
+    return count;
+}
+
+#else
+
+long
+APEX_func_run(APEX_CPU *cpu, long max_insns, int stop_pc)
+{
+    return APEX_func_run_switch(cpu, max_insns, stop_pc);
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * apex_funcbench.c
+ * Throughput of the functional interpreters in apex_func.c
+ *
+ * Runs a program from the start on the plain switch interpreter and on the
+ * threaded one, each for up to --insns instructions (default 100000000)
+ * or until HALT, and prints the instructions per host second of both. A
+ * program with a long running loop gives the steadiest numbers. The two
+ * runs must leave the same registers, data memory, flag and PC; the exit
+ * status is 1 if they do not.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "apex_cpu.h"
+
+#define DEFAULT_INSNS 100000000L
+
+typedef long (*func_runner)(APEX_CPU *cpu, long max_insns, int stop_pc);
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [--insns <n>] <input_file>\n", prog);
+}
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs one interpreter on a fresh CPU, NULL if the program cannot be loaded */
+static APEX_CPU *
+bench(const char *name, func_runner run, const char *filename, long insns)
+{
+    APEX_CPU *cpu = APEX_cpu_init(filename, NULL);
+    double start, seconds;
+    long count;
+
+    if (!cpu)
+    {
+        return NULL;
+    }
+    start = now_seconds();
+    count = run(cpu, insns, -1);
+    seconds = now_seconds() - start;
+    printf("%-9s instructions = %ld seconds = %.3f rate = %.1f M/s\n", name, count, seconds,
+           seconds > 0 ? count / seconds / 1e6 : 0.0);
+    return cpu;
+}
+
+static int
+same_state(const APEX_CPU *a, const APEX_CPU *b)
+{
+    return a->pc == b->pc && a->zero_flag == b->zero_flag && a->func_insns == b->func_insns &&
+           memcmp(a->regs, b->regs, sizeof(a->regs)) == 0 &&
+           memcmp(a->data_memory, b->data_memory, sizeof(a->data_memory)) == 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    const char *filename = NULL;
+    long insns = DEFAULT_INSNS;
+    APEX_CPU *plain, *threaded;
+    int i, ok;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--insns") == 0 && i + 1 < argc)
+        {
+            insns = atol(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !filename)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (!filename)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    plain = bench("switch", APEX_func_run_switch, filename, insns);
+    threaded = bench("threaded", APEX_func_run, filename, insns);
+    if (!plain || !threaded)
+    {
+        fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+        exit(1);
+    }
+
+    ok = same_state(plain, threaded);
+    if (!ok)
+    {
+        fprintf(stderr, "APEX_Error: the interpreters stopped in different states\n");
+    }
+    APEX_cpu_stop(plain);
+    APEX_cpu_stop(threaded);
+    return ok ? 0 : 1;
+}
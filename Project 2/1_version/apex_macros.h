@@ -17,7 +17,30 @@
 
 /* Size of integer register file */
 #define REG_FILE_SIZE 16
-#define PREGS_FILE_SIZE 48
+
+/*
+ * Default microarchitecture, see apex_config.h. Each one can be changed at
+ * run time from a config file or the command line.
+ */
+#define PREGS_FILE_SIZE 48 /* Physical registers */
+#define IQ_SIZE 24         /* Issue queue entries */
+#define ROB_SIZE 64        /* Reorder buffer entries */
+#define MUL_LATENCY 3      /* Cycles a MUL spends in the non-pipelined MUL unit */
+#define MEM_DEPTH 2        /* Stages in the memory unit, M1 and M2 */
+#define LSQ_SIZE 16        /* Load/store queue entries */
+
+/* Speculation depth: rename checkpoints available to in-flight branches */
+#define MAX_BRANCH_CHECKPOINTS 4
+
+/* Reasons decode holds an instruction, counted per cycle in APEX_CPU.stalls */
+#define STALL_NONE -1
+#define STALL_IQ_FULL 0
+#define STALL_ROB_FULL 1
+#define STALL_NO_PREG 2
+#define STALL_NO_CHECKPOINT 3
+#define STALL_LSQ_FULL 4
+#define NUM_STALL_CAUSES 5
+
 /* Numeric OPCODE identifiers for instructions */
 #define OPCODE_ADD 0xf
 #define OPCODE_SUB 0x1
@@ -42,8 +65,39 @@
 #define OPCODE_JAL 0x14
 #define OPCODE_JUMP 0x15
 
-/* Set this flag to 1 to enable debug messages */
-#define ENABLE_DEBUG_MESSAGES 1
+/* Trace levels, each one includes the output of the levels below it */
+#define TRACE_OFF 0    /* Nothing per cycle */
+#define TRACE_COMMIT 1 /* One line per retired instruction */
+#define TRACE_STAGE 2  /* Contents of every enabled stage, every cycle */
+#define TRACE_FULL 3   /* Stages plus the register file, every cycle */
+
+/*
+ * Highest trace level compiled in. A release build sets this to TRACE_OFF
+ * so every trace check folds to a constant and the printing code is
+ * dropped; the runtime level in APEX_CPU can only lower it further.
+ */
+#ifndef APEX_TRACE_MAX
+#define APEX_TRACE_MAX TRACE_FULL
+#endif
+
+/* Stage identifiers, used for trace_stages masks */
+#define STAGE_FETCH 0
+#define STAGE_DECODE 1
+#define STAGE_ISSUEQ 2
+#define STAGE_INTFU 3
+#define STAGE_MULFU 4
+#define STAGE_JBU1 5
+#define STAGE_JBU2 6
+#define STAGE_MEMORY1 7
+#define STAGE_MEMORY2 8
+#define STAGE_ROB 9
+#define NUM_STAGES 10
+#define TRACE_ALL_STAGES ((1u << NUM_STAGES) - 1)
+
+#define TRACE_ON(cpu, level) \
+    (APEX_TRACE_MAX >= (level) && (cpu)->trace_level >= (level))
+#define TRACE_STAGE_ON(cpu, stage) \
+    (TRACE_ON(cpu, TRACE_STAGE) && ((cpu)->trace_stages & (1u << (stage))))
 
 /* Set this flag to 1 to enable cycle single-step mode */
 #define ENABLE_SINGLE_STEP 1
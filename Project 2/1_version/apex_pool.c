@@ -0,0 +1,157 @@
+/*
+ * apex_pool.c
+ * Work-stealing thread pool shared by apex_batch and apex_sweep
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "apex_macros.h"
+#include "apex_pool.h"
+
+typedef struct work_queue
+{
+    pthread_mutex_t lock;
+    int *jobs;
+    int head;
+    int tail;
+} work_queue;
+
+typedef struct apex_pool
+{
+    work_queue *queues;
+    int num_threads;
+    apex_pool_fn fn;
+    void *ctx;
+} apex_pool;
+
+typedef struct pool_worker
+{
+    apex_pool *pool;
+    int id;
+} pool_worker;
+
+/* One thread per online core */
+int
+apex_pool_default_threads(void)
+{
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n : 1;
+}
+
+/* Next job for a worker: its own newest first, then the oldest of another */
+static int
+next_job(apex_pool *pool, int id)
+{
+    int k;
+
+    for (k = 0; k < pool->num_threads; k++)
+    {
+        work_queue *q = &pool->queues[(id + k) % pool->num_threads];
+        int job = -1;
+
+        pthread_mutex_lock(&q->lock);
+        if (q->head != q->tail)
+        {
+            job = k == 0 ? q->jobs[--q->tail] : q->jobs[q->head++];
+        }
+        pthread_mutex_unlock(&q->lock);
+
+        if (job >= 0)
+        {
+            return job;
+        }
+    }
+    return -1;
+}
+
+static void *
+worker_main(void *arg)
+{
+    pool_worker *worker = arg;
+    int job;
+
+    while ((job = next_job(worker->pool, worker->id)) >= 0)
+    {
+        worker->pool->fn(worker->pool->ctx, job);
+    }
+    return NULL;
+}
+
+/*
+ * Runs fn(ctx, job) for every job and returns once all are done. Returns
+ * FALSE, without running anything, if the pool cannot be allocated.
+ */
+int
+apex_pool_run(int num_jobs, int num_threads, apex_pool_fn fn, void *ctx)
+{
+    apex_pool pool;
+    pool_worker *workers;
+    pthread_t *threads;
+    int i, ok = TRUE;
+
+    if (num_jobs <= 0)
+    {
+        return TRUE;
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    if (num_threads > num_jobs)
+    {
+        num_threads = num_jobs;
+    }
+
+    /* Deal the jobs out round robin, each queue gets a contiguous array */
+    pool.num_threads = num_threads;
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.queues = calloc(num_threads, sizeof(work_queue));
+    workers = calloc(num_threads, sizeof(pool_worker));
+    threads = calloc(num_threads, sizeof(pthread_t));
+    if (!pool.queues || !workers || !threads)
+    {
+        free(pool.queues);
+        free(workers);
+        free(threads);
+        return FALSE;
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].jobs = malloc((num_jobs / num_threads + 1) * sizeof(int));
+        ok = ok && pool.queues[i].jobs;
+    }
+
+    if (ok)
+    {
+        for (i = 0; i < num_jobs; i++)
+        {
+            work_queue *q = &pool.queues[i % num_threads];
+
+            q->jobs[q->tail++] = i;
+        }
+
+        for (i = 0; i < num_threads; i++)
+        {
+            workers[i].pool = &pool;
+            workers[i].id = i;
+            pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+        }
+        for (i = 0; i < num_threads; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_mutex_destroy(&pool.queues[i].lock);
+        free(pool.queues[i].jobs);
+    }
+    free(pool.queues);
+    free(workers);
+    free(threads);
+    return ok;
+}
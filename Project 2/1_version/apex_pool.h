@@ -0,0 +1,17 @@
+/*
+ * apex_pool.h
+ * Work-stealing thread pool shared by apex_batch and apex_sweep
+ *
+ * Jobs are numbered 0 .. num_jobs - 1 and dealt out round robin to
+ * per-thread queues. A thread runs the newest job of its own queue and,
+ * once that is empty, steals the oldest job of another.
+ */
+#ifndef _APEX_POOL_H_
+#define _APEX_POOL_H_
+
+typedef void (*apex_pool_fn)(void *ctx, int job);
+
+int apex_pool_default_threads(void);
+int apex_pool_run(int num_jobs, int num_threads, apex_pool_fn fn, void *ctx);
+
+#endif
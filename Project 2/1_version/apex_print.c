@@ -0,0 +1,238 @@
+/*
+ * apex_print.c
+ * Stage trace formatting shared by apex_sim and apex_traceview
+ *
+ * Both the live per-cycle trace and the offline trace viewer go through
+ * these functions, so a rendered binary trace reads exactly like the
+ * text the simulator prints.
+ */
+#include <stdio.h>
+#include "apex_cpu.h"
+
+/* Trace labels indexed by STAGE_* */
+static const char *stage_labels[NUM_STAGES] = {
+    "Fetch", "Decode/RF", "Issueq", "intfu", "mulfu",
+    "jbu1", "jbu2", "Memory1", "Memory2", "ROB "};
+
+/* Assembler mnemonics indexed by opcode, as accepted by file_parser.c */
+static const char *opcode_names[] = {
+    [OPCODE_NULL] = " ",     [OPCODE_SUB] = "SUB",   [OPCODE_MUL] = "MUL",
+    [OPCODE_DIV] = "DIV",    [OPCODE_AND] = "AND",   [OPCODE_OR] = "OR",
+    [OPCODE_XOR] = "EX-OR",  [OPCODE_MOVC] = "MOVC", [OPCODE_LOAD] = "LOAD",
+    [OPCODE_STORE] = "STORE", [OPCODE_BZ] = "BZ",    [OPCODE_BNZ] = "BNZ",
+    [OPCODE_HALT] = "HALT",  [OPCODE_SUBL] = "SUBL", [OPCODE_ADDL] = "ADDL",
+    [OPCODE_ADD] = "ADD",    [OPCODE_STR] = "STR",   [OPCODE_LDR] = "LDR",
+    [OPCODE_CMP] = "CMP",    [OPCODE_NOP] = "NOP",   [OPCODE_JAL] = "JAL",
+    [OPCODE_JUMP] = "JUMP"};
+
+const char *
+APEX_opcode_name(int opcode)
+{
+    if (opcode < 0 || opcode >= (int)(sizeof(opcode_names) / sizeof(opcode_names[0])) ||
+        !opcode_names[opcode])
+    {
+        return " ";
+    }
+    return opcode_names[opcode];
+}
+
+const char *
+APEX_stall_name(int cause)
+{
+    static const char *const names[NUM_STALL_CAUSES] = {
+        [STALL_IQ_FULL] = "iq_full",
+        [STALL_ROB_FULL] = "rob_full",
+        [STALL_NO_PREG] = "no_preg",
+        [STALL_NO_CHECKPOINT] = "no_checkpoint",
+        [STALL_LSQ_FULL] = "lsq_full",
+    };
+
+    return cause >= 0 && cause < NUM_STALL_CAUSES ? names[cause] : "none";
+}
+
+static void
+print_instruction(const CPU_Stage *stage)
+{
+    const char *name = APEX_opcode_name(stage->opcode);
+
+    switch (stage->opcode)
+    {
+    case OPCODE_STR:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_LDR:
+    {
+        printf("%s,R%d,R%d,R%d", name, stage->rd, stage->rs1,
+               stage->rs2);
+        break;
+    }
+
+    case OPCODE_MOVC:
+    {
+        printf("%s,R%d,#%d", name, stage->rd, stage->imm);
+        break;
+    }
+
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_JAL:
+    {
+        printf("%s,R%d,R%d,#%d ", name, stage->rd, stage->rs1,
+               stage->imm);
+        break;
+    }
+
+    case OPCODE_STORE:
+    {
+        printf("%s,R%d,R%d,#%d ", name, stage->rs1, stage->rs2,
+               stage->imm);
+        break;
+    }
+
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    {
+        printf("%s,#%d ", name, stage->imm);
+        break;
+    }
+    case OPCODE_JUMP:
+    {
+        printf("%s R%d,#%d ", name, stage->rs1, stage->imm);
+        break;
+    }
+
+    case OPCODE_CMP:
+    {
+        printf("%s R%d,R%d ", name, stage->rs1, stage->rs2);
+        break;
+    }
+
+    case OPCODE_HALT:
+    {
+        printf("%s", name);
+        break;
+    }
+
+    case OPCODE_NULL:
+    {
+        printf(" ");
+        break;
+    }
+    case OPCODE_NOP:
+        printf("%s", name);
+    }
+}
+
+static void
+print_instruction_with_renamed_registers(const CPU_Stage *stage)
+{
+    const char *name = APEX_opcode_name(stage->opcode);
+
+    switch (stage->opcode)
+    {
+    case OPCODE_STR:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_LDR:
+    {
+        printf("%s,R%d,R%d,R%d\t\t%s,P%d,P%d,P%d", name, stage->rd, stage->rs1,
+               stage->rs2, name, stage->pd, stage->ps1, stage->ps2);
+        break;
+    }
+
+    case OPCODE_MOVC:
+    {
+        printf("%s,R%d,#%d\t\t%s,P%d,#%d", name, stage->rd, stage->imm, name, stage->pd, stage->imm);
+        break;
+    }
+
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_JAL:
+    {
+        printf("%s,R%d,R%d,#%d\t\t%s,P%d,P%d,#%d", name, stage->rd, stage->rs1,
+               stage->imm, name, stage->pd, stage->ps1, stage->imm);
+        break;
+    }
+
+    case OPCODE_STORE:
+    {
+        printf("%s,R%d,R%d,#%d\t%s,P%d,P%d,#%d", name, stage->rs1, stage->rs2,
+               stage->imm, name, stage->ps1, stage->ps2, stage->imm);
+        break;
+    }
+
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    {
+        /* ps1 is the physical Z flag the branch reads */
+        printf("%s,#%d\t\t%s,P%d,#%d", name, stage->imm, name, stage->ps1, stage->imm);
+        break;
+    }
+
+    case OPCODE_CMP:
+    {
+        printf("%s R%d,R%d\t\t%s P%d,P%d", name, stage->rs1, stage->rs2, name, stage->ps1, stage->ps2);
+        break;
+    }
+
+    case OPCODE_HALT:
+    {
+        printf("%s", name);
+        break;
+    }
+    case OPCODE_JUMP:
+    {
+        printf("%s R%d,#%d\t\t%s P%d,#%d", name, stage->rs1, stage->imm, name, stage->ps1, stage->imm);
+        break;
+    }
+
+    case OPCODE_NULL:
+    {
+        printf(" ");
+        break;
+    }
+    case OPCODE_NOP:
+        printf("%s", name);
+    }
+}
+
+/*
+ * Prints one stage line. Fetch shows the instruction as fetched, every
+ * later stage adds the renamed physical registers.
+ */
+void
+APEX_print_stage(int stage_id, const CPU_Stage *stage)
+{
+    printf("%-15s: pc(%d) ", stage_labels[stage_id], stage->pc);
+    if (stage_id == STAGE_FETCH)
+    {
+        print_instruction(stage);
+    }
+    else
+    {
+        print_instruction_with_renamed_registers(stage);
+    }
+    printf("\n");
+}
+
+/* Trace line for a retired instruction, shown from TRACE_COMMIT upwards */
+void
+APEX_print_commit(int cycle, const CPU_Stage *stage)
+{
+    printf("%-15s: cycle(%d) pc(%d) ", "Commit", cycle, stage->pc);
+    print_instruction_with_renamed_registers(stage);
+    printf("\n");
+}
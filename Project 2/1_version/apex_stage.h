@@ -0,0 +1,74 @@
+/*
+ * apex_stage.h
+ * Instruction and pipeline latch formats
+ *
+ * Kept apart from apex_cpu.h so that the out-of-order structures, which
+ * hold latches, can be embedded in APEX_CPU.
+ */
+#ifndef _APEX_STAGE_H_
+#define _APEX_STAGE_H_
+
+#include <stdint.h>
+#include "apex_macros.h"
+#include "ras.h"
+
+/*
+ * Format of an APEX instruction, decoded once by the parser. The mnemonic
+ * is not stored; APEX_opcode_name() looks it up when printing.
+ */
+typedef struct APEX_Instruction
+{
+    uint8_t opcode;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;
+} APEX_Instruction;
+
+/* Model of CPU stage latch */
+typedef struct CPU_Stage
+{
+    int trial;
+    int pc;
+    int opcode;
+    int rs1;
+    int rs2;
+    int rd;
+    int ps1;
+    int ps2;
+    int pd;
+    int imm;
+    int rs1_value;
+    int rs2_value;
+    int rd_value;
+    int ps1_value;
+    int ps2_value;
+    int result_buffer;
+    int memory_address;
+    int has_insn;
+    int stalled;
+    int flush;
+    int instype;
+    int checkpoint; /* Rename table checkpoint slot held by a branch, its tag */
+    unsigned int branch_mask; /* Tags of the unresolved branches older than this */
+    int prev_pd;    /* Mapping of rd before this instruction, freed at commit */
+    int rob_id;     /* ROB slot taken at dispatch */
+    int lsq_id;     /* LSQ slot of a memory op, else LSQ_NONE */
+    int mem_issued; /* Memory op already sent to the memory unit */
+    int mem_ready;  /* Memory op's address operands are available */
+    int pf;         /* Physical Z flag of a CMP, ADD(L) or SUB(L), else -1 */
+    int prev_pf;    /* Flag mapping before this instruction, freed at commit */
+    int branch_done;  /* Set in the ROB entry once JBU1 has resolved it */
+    int branch_taken;
+    int pred_taken;   /* Fetch followed a taken prediction to a BTB or RAS target */
+    int pred_pc;      /* PC fetch went on to after this instruction */
+    int btb_hit;      /* The BTB had an entry when this was fetched */
+    int mispredicted; /* Set by JBU1 when fetch went the wrong way */
+    unsigned int pred_history; /* Global branch history when this was fetched */
+    ras_checkpoint ras;        /* Return address stack when this was fetched */
+
+    //int zero_flag;
+
+} CPU_Stage;
+
+#endif
@@ -0,0 +1,494 @@
+/*
+ * apex_sweep.c
+ * Design-space sweep over apex_config.h parameters
+ *
+ * Every key=values argument is one axis of the grid, every other argument
+ * a program. Values are a comma separated list of numbers, value names or
+ * inclusive lo:hi[:step] ranges, and every program is run at every point:
+ *
+ *     apex_sweep iq_size=8,16,24 rob_size=16:64:16 predictor=last,gshare 1.asm 2.asm
+ *
+ * Results are cached on disk, one small file per run, named by a hash of
+ * the program text, the configuration and the cycle limit. A rerun after
+ * editing the grid only simulates the points it has not seen. The runs
+ * that are left go through the apex_pool.h thread pool, and the CSV rows
+ * are written in grid order.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "apex_cpu.h"
+#include "apex_pool.h"
+
+/* Part of every cache key, bump it when a simulator change alters any result */
+#define SWEEP_MODEL_VERSION 9
+
+#define SWEEP_DEFAULT_CACHE ".apex_sweep_cache"
+#define SWEEP_DEFAULT_MAX_CYCLES 1000000L
+#define MAX_DESCRIPTION 256
+
+typedef struct sweep_axis
+{
+    const char *key;
+    int *values;
+    int count;
+} sweep_axis;
+
+typedef struct sweep_program
+{
+    const char *filename;
+    uint64_t hash; /* FNV-1a of the file contents */
+} sweep_program;
+
+typedef struct sweep_job
+{
+    const sweep_program *program;
+    APEX_Config config;
+    char description[MAX_DESCRIPTION]; /* Everything the result depends on */
+    uint64_t key;
+    /* Result */
+    int status; /* 0 halted, 1 error, 2 cycle limit, as in apex_batch */
+    int cycles;
+    int instructions;
+    int branches;
+    int mispredicts;
+    int stalls[NUM_STALL_CAUSES];
+    int cached;
+} sweep_job;
+
+typedef struct sweep_run
+{
+    sweep_job *jobs;
+    int *pending; /* Jobs not found in the cache */
+    const char *cache_dir;
+    long max_cycles;
+} sweep_run;
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr,
+            "APEX_Help: Usage %s [--threads <n>] [--output <file>] [--max-cycles <n>]\n"
+            "           [--cache <dir> | --no-cache] key=values... program...\n",
+            prog);
+}
+
+static uint64_t
+fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Hashes a whole file, FALSE if it cannot be read */
+static int
+hash_file(const char *filename, uint64_t *hash)
+{
+    unsigned char buffer[4096];
+    size_t n;
+    FILE *fp = fopen(filename, "rb");
+
+    if (!fp)
+    {
+        return FALSE;
+    }
+
+    *hash = 14695981039346656037ULL;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    {
+        *hash = fnv1a(*hash, buffer, n);
+    }
+    fclose(fp);
+    return TRUE;
+}
+
+/* Appends one number to an axis */
+static int
+add_value(sweep_axis *axis, int value)
+{
+    int *values = realloc(axis->values, (axis->count + 1) * sizeof(int));
+
+    if (!values)
+    {
+        return FALSE;
+    }
+    axis->values = values;
+    axis->values[axis->count++] = value;
+    return TRUE;
+}
+
+/*
+ * Parses "key=a,b,lo:hi:step" into an axis. Returns FALSE for an unknown
+ * key or a malformed value list.
+ */
+static int
+parse_axis(sweep_axis *axis, char *arg)
+{
+    char *equals = strchr(arg, '=');
+    char *save, *item;
+    APEX_Config scratch;
+    char probe[64];
+
+    if (!equals)
+    {
+        return FALSE;
+    }
+    *equals = '\0';
+    axis->key = arg;
+
+    /* Only the key is checked here, ranges are checked per point */
+    APEX_config_default(&scratch);
+    snprintf(probe, sizeof(probe), "%s=0", arg);
+    if (!APEX_config_set(&scratch, probe))
+    {
+        return FALSE;
+    }
+
+    for (item = strtok_r(equals + 1, ",", &save); item; item = strtok_r(NULL, ",", &save))
+    {
+        long lo, hi, step = 1;
+        char *end;
+
+        int named;
+
+        lo = strtol(item, &end, 10);
+        hi = lo;
+        if (end == item)
+        {
+            if (!APEX_config_parse(axis->key, item, &named) || !add_value(axis, named))
+            {
+                return FALSE;
+            }
+            continue;
+        }
+        if (*end == ':')
+        {
+            char *start = end + 1;
+
+            hi = strtol(start, &end, 10);
+            if (end == start)
+            {
+                return FALSE;
+            }
+            if (*end == ':')
+            {
+                start = end + 1;
+                step = strtol(start, &end, 10);
+                if (end == start || step <= 0)
+                {
+                    return FALSE;
+                }
+            }
+        }
+        if (*end != '\0' || hi < lo)
+        {
+            return FALSE;
+        }
+
+        for (; lo <= hi; lo += step)
+        {
+            if (!add_value(axis, (int)lo))
+            {
+                return FALSE;
+            }
+        }
+    }
+    return axis->count > 0;
+}
+
+static void
+cache_path(const sweep_run *run, const sweep_job *job, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%016llx", run->cache_dir, (unsigned long long)job->key);
+}
+
+/*
+ * Fills in a job's result from the cache. The first line of a cache file
+ * repeats the job description, so a hash collision reads as a miss.
+ */
+static int
+cache_load(const sweep_run *run, sweep_job *job)
+{
+    char path[1024], line[MAX_DESCRIPTION + 2];
+    FILE *fp;
+    int ok, i;
+
+    cache_path(run, job, path, sizeof(path));
+    fp = fopen(path, "r");
+    if (!fp)
+    {
+        return FALSE;
+    }
+
+    ok = fgets(line, sizeof(line), fp) != NULL;
+    line[strcspn(line, "\n")] = '\0';
+    ok = ok && strcmp(line, job->description) == 0;
+    ok = ok && fscanf(fp, "%d %d %d %d %d", &job->status, &job->cycles,
+                      &job->instructions, &job->branches, &job->mispredicts) == 5;
+    for (i = 0; i < NUM_STALL_CAUSES; i++)
+    {
+        ok = ok && fscanf(fp, "%d", &job->stalls[i]) == 1;
+    }
+    ok = ok && job->status >= 0 && job->status <= 2;
+    fclose(fp);
+    return ok;
+}
+
+/* Writes a result through a temporary file so readers never see half of it */
+static void
+cache_store(const sweep_run *run, const sweep_job *job, int id)
+{
+    char path[1024], tmp[1100];
+    FILE *fp;
+    int i;
+
+    cache_path(run, job, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%d.tmp", path, (long)getpid(), id);
+    fp = fopen(tmp, "w");
+    if (!fp)
+    {
+        return;
+    }
+
+    fprintf(fp, "%s\n%d %d %d %d %d", job->description, job->status, job->cycles,
+            job->instructions, job->branches, job->mispredicts);
+    for (i = 0; i < NUM_STALL_CAUSES; i++)
+    {
+        fprintf(fp, " %d", job->stalls[i]);
+    }
+    fprintf(fp, "\n");
+    if (fclose(fp) != 0 || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+    }
+}
+
+static void
+run_sweep_job(void *ctx, int index)
+{
+    sweep_run *run = ctx;
+    int id = run->pending[index];
+    sweep_job *job = &run->jobs[id];
+    APEX_CPU *cpu = APEX_cpu_init(job->program->filename, &job->config);
+
+    if (!cpu)
+    {
+        job->status = 1;
+        return;
+    }
+
+    cpu->trace_level = TRACE_OFF;
+    job->status = APEX_cpu_run_to_halt(cpu, run->max_cycles, TRUE);
+    job->cycles = cpu->clock;
+    job->instructions = cpu->insn_completed;
+    job->branches = cpu->branch_totals.executed;
+    job->mispredicts = cpu->branch_totals.mispredicts;
+    memcpy(job->stalls, cpu->stalls, sizeof(job->stalls));
+    APEX_cpu_stop(cpu);
+
+    if (run->cache_dir)
+    {
+        cache_store(run, job, id);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = NULL;
+    int num_threads = apex_pool_default_threads();
+    sweep_run run;
+    sweep_axis *axes;
+    sweep_program *programs;
+    int num_axes = 0, num_programs = 0, num_points = 1, num_jobs, num_pending = 0;
+    FILE *out = stdout;
+    int failed = 0;
+    int i, k;
+
+    run.cache_dir = SWEEP_DEFAULT_CACHE;
+    run.max_cycles = SWEEP_DEFAULT_MAX_CYCLES;
+    axes = calloc(argc, sizeof(sweep_axis));
+    programs = calloc(argc, sizeof(sweep_program));
+    if (!axes || !programs)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory\n");
+        exit(1);
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            run.max_cycles = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            run.cache_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0)
+        {
+            run.cache_dir = NULL;
+        }
+        else if (argv[i][0] == '-')
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+        else if (strchr(argv[i], '='))
+        {
+            if (!parse_axis(&axes[num_axes], argv[i]))
+            {
+                fprintf(stderr, "APEX_Error: Bad sweep axis %s\n", argv[i]);
+                exit(1);
+            }
+            num_points *= axes[num_axes++].count;
+        }
+        else
+        {
+            programs[num_programs].filename = argv[i];
+            if (!hash_file(argv[i], &programs[num_programs].hash))
+            {
+                fprintf(stderr, "APEX_Error: Unable to open %s\n", argv[i]);
+                exit(1);
+            }
+            num_programs++;
+        }
+    }
+
+    if (num_programs == 0)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    if (run.cache_dir && mkdir(run.cache_dir, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create %s\n", run.cache_dir);
+        exit(1);
+    }
+
+    /* Expand the grid, the last axis varies fastest */
+    num_jobs = num_programs * num_points;
+    run.jobs = calloc(num_jobs, sizeof(sweep_job));
+    run.pending = calloc(num_jobs, sizeof(int));
+    if (!run.jobs || !run.pending)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        sweep_job *job = &run.jobs[i];
+        int point = i % num_points;
+        char setting[64], settings[MAX_DESCRIPTION - 64];
+        const char *bad;
+
+        job->program = &programs[i / num_points];
+        APEX_config_default(&job->config);
+        for (k = num_axes - 1; k >= 0; k--)
+        {
+            snprintf(setting, sizeof(setting), "%s=%d", axes[k].key,
+                     axes[k].values[point % axes[k].count]);
+            APEX_config_set(&job->config, setting);
+            point /= axes[k].count;
+        }
+
+        bad = APEX_config_check(&job->config);
+        if (bad)
+        {
+            fprintf(stderr, "APEX_Error: %s is out of range\n", bad);
+            exit(1);
+        }
+
+        APEX_config_format(&job->config, settings, sizeof(settings));
+        snprintf(job->description, sizeof(job->description),
+                 "v%d %016llx %s max_cycles=%ld", SWEEP_MODEL_VERSION,
+                 (unsigned long long)job->program->hash, settings, run.max_cycles);
+        job->key = fnv1a(14695981039346656037ULL, job->description,
+                         strlen(job->description));
+
+        job->cached = run.cache_dir && cache_load(&run, job);
+        if (!job->cached)
+        {
+            run.pending[num_pending++] = i;
+        }
+    }
+
+    if (!apex_pool_run(num_pending, num_threads, run_sweep_job, &run))
+    {
+        fprintf(stderr, "APEX_Error: Out of memory\n");
+        exit(1);
+    }
+    fprintf(stderr, "APEX_Sweep: %d runs, %d cached, %d simulated\n", num_jobs,
+            num_jobs - num_pending, num_pending);
+
+    if (output)
+    {
+        out = fopen(output, "w");
+        if (!out)
+        {
+            fprintf(stderr, "APEX_Error: Unable to create %s\n", output);
+            exit(1);
+        }
+    }
+
+    fprintf(out, "program,iq_size,rob_size,pregs,mul_latency,mem_depth,predictor,lsq_size,lsq_mode,"
+                 "status,"
+                 "cycles,instructions,ipc,branches,mispredicts");
+    for (k = 0; k < NUM_STALL_CAUSES; k++)
+    {
+        fprintf(out, ",stall_%s", APEX_stall_name(k));
+    }
+    fprintf(out, ",cached\n");
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        const sweep_job *job = &run.jobs[i];
+        static const char *status_names[] = {"halted", "error", "max_cycles"};
+
+        fprintf(out, "%s,%d,%d,%d,%d,%d,%s,%d,%s,%s,%d,%d,%.3f,%d,%d", job->program->filename,
+                job->config.iq_size, job->config.rob_size, job->config.pregs,
+                job->config.mul_latency, job->config.mem_depth,
+                predictor_names[job->config.predictor], job->config.lsq_size,
+                lsq_mode_names[job->config.lsq_mode], status_names[job->status],
+                job->cycles, job->instructions,
+                job->cycles ? (double)job->instructions / job->cycles : 0.0,
+                job->branches, job->mispredicts);
+        for (k = 0; k < NUM_STALL_CAUSES; k++)
+        {
+            fprintf(out, ",%d", job->stalls[k]);
+        }
+        fprintf(out, ",%d\n", job->cached);
+        failed |= job->status != 0;
+    }
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    for (k = 0; k < num_axes; k++)
+    {
+        free(axes[k].values);
+    }
+    free(axes);
+    free(programs);
+    free(run.jobs);
+    free(run.pending);
+    return failed;
+}
@@ -0,0 +1,69 @@
+/*
+ * apex_trace.c
+ * Buffered writer for the binary pipeline event trace
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "apex_trace.h"
+
+/*
+ * Creates the trace file and writes the header and code image. Returns
+ * NULL if the file cannot be created.
+ */
+apex_trace_writer *
+apex_trace_open(const char *path, const APEX_CPU *cpu)
+{
+    apex_trace_writer *w;
+    apex_trace_header header;
+
+    w = calloc(1, sizeof(apex_trace_writer));
+    if (!w)
+    {
+        return NULL;
+    }
+
+    w->buffer = malloc(APEX_TRACE_BUFFER_RECORDS * sizeof(apex_trace_record));
+    w->fp = fopen(path, "wb");
+    if (!w->buffer || !w->fp)
+    {
+        if (w->fp)
+        {
+            fclose(w->fp);
+        }
+        free(w->buffer);
+        free(w);
+        return NULL;
+    }
+
+    memcpy(header.magic, APEX_TRACE_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(apex_trace_record);
+    header.code_size = cpu->code_memory_size;
+    fwrite(&header, sizeof(header), 1, w->fp);
+
+    fwrite(cpu->code_memory, sizeof(APEX_Instruction), cpu->code_memory_size, w->fp);
+    return w;
+}
+
+void
+apex_trace_flush(apex_trace_writer *w)
+{
+    if (w->count)
+    {
+        fwrite(w->buffer, sizeof(apex_trace_record), w->count, w->fp);
+        w->count = 0;
+    }
+}
+
+void
+apex_trace_close(apex_trace_writer *w)
+{
+    if (!w)
+    {
+        return;
+    }
+
+    apex_trace_flush(w);
+    fclose(w->fp);
+    free(w->buffer);
+    free(w);
+}
@@ -0,0 +1,82 @@
+/*
+ * apex_trace.h
+ * Binary pipeline event trace
+ *
+ * A trace file starts with an apex_trace_header and a copy of the code
+ * memory, followed by fixed size event records. Every record names the
+ * cycle, the stage (or TRACE_EVENT_COMMIT), the PC, the ROB ID and the
+ * physical tags of one occupied latch; the static
+ * instruction fields are looked up from the code image by PC, so a
+ * record is 20 bytes instead of a formatted text line. apex_traceview
+ * renders a trace back into the simulator's text layout.
+ */
+#ifndef _APEX_TRACE_H_
+#define _APEX_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "apex_cpu.h"
+
+#define APEX_TRACE_MAGIC "APEXEVT1"
+
+/* Stage ID used for retirement events, after the STAGE_* range */
+#define TRACE_EVENT_COMMIT NUM_STAGES
+
+/* Records held in memory before a write, 1.25 MB */
+#define APEX_TRACE_BUFFER_RECORDS 65536
+
+typedef struct apex_trace_header
+{
+    char magic[8];
+    uint32_t record_size;
+    uint32_t code_size; /* APEX_Instruction entries that follow */
+} apex_trace_header;
+
+typedef struct apex_trace_record
+{
+    uint32_t cycle;
+    uint32_t pc;
+    int16_t rob_id;
+    int16_t pd;
+    int16_t ps1;
+    int16_t ps2;
+    uint8_t stage;
+    uint8_t opcode;
+    uint16_t reserved;
+} apex_trace_record;
+
+_Static_assert(sizeof(apex_trace_record) == 20, "trace records are 20 bytes");
+
+typedef struct apex_trace_writer
+{
+    FILE *fp;
+    apex_trace_record *buffer;
+    int count;
+} apex_trace_writer;
+
+apex_trace_writer *apex_trace_open(const char *path, const APEX_CPU *cpu);
+void apex_trace_flush(apex_trace_writer *w);
+void apex_trace_close(apex_trace_writer *w);
+
+/* Appends one event, writing the buffer out when it fills */
+static inline void
+apex_trace_emit(apex_trace_writer *w, int cycle, int stage_id, const CPU_Stage *stage)
+{
+    apex_trace_record *r = &w->buffer[w->count];
+
+    r->cycle = cycle;
+    r->pc = stage->pc;
+    r->rob_id = stage->rob_id;
+    r->pd = stage->pd;
+    r->ps1 = stage->ps1;
+    r->ps2 = stage->ps2;
+    r->stage = stage_id;
+    r->opcode = stage->opcode;
+    r->reserved = 0;
+    if (++w->count == APEX_TRACE_BUFFER_RECORDS)
+    {
+        apex_trace_flush(w);
+    }
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * apex_traceview.c
+ * Offline renderer for binary pipeline traces written by apex_sim
+ *
+ * Prints a trace in the same layout as the simulator's live stage trace:
+ * a clock cycle banner followed by one line per occupied stage, with
+ * commit lines where instructions retired. --commit prints the retired
+ * instructions only, like --trace commit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_trace.h"
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [--commit] <trace_file>\n", prog);
+}
+
+/* Rebuilds the latch a record was taken from */
+static void
+record_to_stage(const apex_trace_record *r, const APEX_Instruction *code,
+                int code_size, CPU_Stage *stage)
+{
+    int index = ((int)r->pc - 4000) / 4;
+
+    memset(stage, 0, sizeof(*stage));
+    stage->pc = r->pc;
+    stage->opcode = r->opcode;
+    stage->rob_id = r->rob_id;
+    stage->pd = r->pd;
+    stage->ps1 = r->ps1;
+    stage->ps2 = r->ps2;
+    if (index >= 0 && index < code_size)
+    {
+        stage->rd = code[index].rd;
+        stage->rs1 = code[index].rs1;
+        stage->rs2 = code[index].rs2;
+        stage->imm = code[index].imm;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    const char *filename = NULL;
+    int commit_only = FALSE;
+    apex_trace_header header;
+    APEX_Instruction *code;
+    apex_trace_record *records;
+    size_t n, k;
+    long cycle = 0;
+    FILE *fp;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--commit") == 0)
+        {
+            commit_only = TRUE;
+        }
+        else if (argv[i][0] != '-' && !filename)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (!filename)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open %s\n", filename);
+        exit(1);
+    }
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, APEX_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(apex_trace_record))
+    {
+        fprintf(stderr, "APEX_Error: %s is not an APEX event trace\n", filename);
+        exit(1);
+    }
+
+    code = calloc(header.code_size ? header.code_size : 1, sizeof(APEX_Instruction));
+    records = malloc(APEX_TRACE_BUFFER_RECORDS * sizeof(apex_trace_record));
+    if (!code || !records ||
+        fread(code, sizeof(APEX_Instruction), header.code_size, fp) != header.code_size)
+    {
+        fprintf(stderr, "APEX_Error: Truncated trace %s\n", filename);
+        exit(1);
+    }
+
+    while ((n = fread(records, sizeof(apex_trace_record), APEX_TRACE_BUFFER_RECORDS, fp)) > 0)
+    {
+        for (k = 0; k < n; k++)
+        {
+            const apex_trace_record *r = &records[k];
+            CPU_Stage stage;
+
+            if (commit_only && r->stage != TRACE_EVENT_COMMIT)
+            {
+                continue;
+            }
+
+            /* Cycles without events still get their banner */
+            while (!commit_only && cycle < (long)r->cycle)
+            {
+                cycle++;
+                printf("--------------------------------------------\n");
+                printf("Clock Cycle #: %ld\n", cycle);
+                printf("--------------------------------------------\n");
+            }
+
+            record_to_stage(r, code, header.code_size, &stage);
+            if (r->stage == TRACE_EVENT_COMMIT)
+            {
+                APEX_print_commit(r->cycle, &stage);
+            }
+            else if (r->stage < NUM_STAGES)
+            {
+                APEX_print_stage(r->stage, &stage);
+            }
+        }
+    }
+
+    free(records);
+    free(code);
+    fclose(fp);
+    return 0;
+}
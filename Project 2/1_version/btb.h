@@ -0,0 +1,72 @@
+/*
+ * btb.h
+ * Fully associative branch target buffer used by the fetch stage
+ *
+ * An entry is set up the first time a BZ, BNZ, JAL or JUMP resolves in
+ * JBU1 and holds the instruction's address and its last target. Returns
+ * are left to the RAS in ras.h. Fetch looks the PC up
+ * in parallel; the direction comes from the predictor in predictor.h, and
+ * a branch without an entry is predicted not taken since there is no
+ * target to go to. Once all BTB_SIZE entries are in use the oldest one is
+ * replaced.
+ */
+#ifndef _BTB_H_
+#define _BTB_H_
+
+#include "apex_macros.h"
+
+#define BTB_SIZE 8
+
+typedef struct btb_entry
+{
+    int valid;
+    int pc;
+    int target;
+} btb_entry;
+
+typedef struct branch_target_buffer
+{
+    btb_entry entry[BTB_SIZE];
+    int next_victim; /* Entry replaced by the next new branch */
+} branch_target_buffer;
+
+/* Per static branch counts, recorded at commit */
+typedef struct branch_stats
+{
+    int executed;
+    int btb_hits;    /* Fetched with a BTB entry present */
+    int mispredicts;
+} branch_stats;
+
+static inline btb_entry *
+btb_lookup(branch_target_buffer *b, int pc)
+{
+    int i;
+
+    for (i = 0; i < BTB_SIZE; i++)
+    {
+        if (b->entry[i].valid && b->entry[i].pc == pc)
+        {
+            return &b->entry[i];
+        }
+    }
+    return NULL;
+}
+
+/* Records a resolved branch's target, setting up its entry on first use */
+static inline void
+btb_update(branch_target_buffer *b, int pc, int target)
+{
+    btb_entry *e = btb_lookup(b, pc);
+
+    if (!e)
+    {
+        e = &b->entry[b->next_victim];
+        b->next_victim = (b->next_victim + 1) % BTB_SIZE;
+        e->valid = TRUE;
+        e->pc = pc;
+    }
+    e->target = target;
+}
+
+#endif
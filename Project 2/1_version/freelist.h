@@ -0,0 +1,187 @@
+/*
+ * freelist.h
+ * Bitmap free list of physical registers
+ *
+ * A set bit means the physical register is free. Allocation takes the
+ * lowest set bit with count-trailing-zeros and freeing sets the bit again.
+ * The mask spans as many 64-bit words as the register file needs, so a
+ * branch checkpoint of the whole list is a copy of one word per 64
+ * registers.
+ */
+#ifndef _FREELIST_H_
+#define _FREELIST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_stage.h"
+
+typedef struct free_list
+{
+    uint64_t *bits;
+    int count;
+    int num_regs;
+    int words;                                 /* 64-bit words per mask */
+    uint64_t *saved[MAX_BRANCH_CHECKPOINTS];
+    int saved_count[MAX_BRANCH_CHECKPOINTS];
+    unsigned int used_mask; /* Checkpoint slots held by in-flight branches */
+} free_list;
+
+/* Allocates a list with all num_regs registers free, FALSE if out of memory */
+static inline int
+freelist_init(free_list *f, int num_regs)
+{
+    int i, ok;
+
+    f->num_regs = num_regs;
+    f->words = (num_regs + 63) / 64;
+    f->bits = calloc(f->words, sizeof(uint64_t));
+    ok = f->bits != NULL;
+    for (i = 0; i < MAX_BRANCH_CHECKPOINTS; i++)
+    {
+        f->saved[i] = calloc(f->words, sizeof(uint64_t));
+        ok = ok && f->saved[i] != NULL;
+    }
+    if (!ok)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < num_regs; i++)
+    {
+        f->bits[i / 64] |= 1ULL << (i % 64);
+    }
+    f->count = num_regs;
+    f->used_mask = 0;
+    return TRUE;
+}
+
+static inline void
+freelist_destroy(free_list *f)
+{
+    int i;
+
+    free(f->bits);
+    for (i = 0; i < MAX_BRANCH_CHECKPOINTS; i++)
+    {
+        free(f->saved[i]);
+    }
+}
+
+static inline int
+freelist_empty(const free_list *f)
+{
+    return f->count == 0;
+}
+
+/* Lowest numbered free register, or -1 if none is left */
+static inline int
+freelist_alloc(free_list *f)
+{
+    int w;
+
+    for (w = 0; w < f->words; w++)
+    {
+        if (f->bits[w])
+        {
+            int bit = __builtin_ctzll(f->bits[w]);
+
+            f->bits[w] &= f->bits[w] - 1;
+            f->count--;
+            return w * 64 + bit;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Returns a register to the list. The register is also marked free in
+ * every live checkpoint, since it was released by an instruction older
+ * than all in-flight branches and must stay free after a restore.
+ */
+static inline void
+freelist_free(free_list *f, int preg)
+{
+    unsigned int slots = f->used_mask;
+    uint64_t bit;
+
+    if (preg < 0 || preg >= f->num_regs)
+    {
+        return;
+    }
+    bit = 1ULL << (preg % 64);
+    if (f->bits[preg / 64] & bit)
+    {
+        return;
+    }
+
+    f->bits[preg / 64] |= bit;
+    f->count++;
+    while (slots)
+    {
+        int slot = __builtin_ctz(slots);
+
+        slots &= slots - 1;
+        f->saved[slot][preg / 64] |= bit;
+        f->saved_count[slot]++;
+    }
+}
+
+/*
+ * Returns a register taken by a squashed instruction without a
+ * checkpoint to restore. It was allocated after every live checkpoint,
+ * so those already have it free and only the current list changes.
+ */
+static inline void
+freelist_unalloc(free_list *f, int preg)
+{
+    uint64_t bit;
+
+    if (preg < 0 || preg >= f->num_regs)
+    {
+        return;
+    }
+    bit = 1ULL << (preg % 64);
+    if (f->bits[preg / 64] & bit)
+    {
+        return;
+    }
+
+    f->bits[preg / 64] |= bit;
+    f->count++;
+}
+
+/* Snapshots the list into a slot handed out by the rename table */
+static inline void
+freelist_checkpoint(free_list *f, int slot)
+{
+    memcpy(f->saved[slot], f->bits, f->words * sizeof(uint64_t));
+    f->saved_count[slot] = f->count;
+    f->used_mask |= 1u << slot;
+}
+
+static inline void
+freelist_release(free_list *f, int slot)
+{
+    if (slot >= 0)
+    {
+        f->used_mask &= ~(1u << slot);
+    }
+}
+
+static inline void
+freelist_retain(free_list *f, unsigned int keep)
+{
+    f->used_mask &= keep;
+}
+
+/* Returns every register allocated after the snapshot to the list */
+static inline void
+freelist_restore(free_list *f, int slot)
+{
+    memcpy(f->bits, f->saved[slot], f->words * sizeof(uint64_t));
+    f->count = f->saved_count[slot];
+    freelist_release(f, slot);
+}
+
+#endif
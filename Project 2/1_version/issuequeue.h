@@ -0,0 +1,342 @@
+/*
+ * issuequeue.h
+ * Fixed-capacity issue queue used by the IQ stage
+ *
+ * Entries live in a slot array. Three bitmasks track which slots are free,
+ * which hold an instruction and which have all of their source operands
+ * available, so dispatch, wakeup, select and removal never walk a list.
+ * Wakeup goes through a consumer bitmap per physical tag, the slots still
+ * waiting on it, so a broadcast only touches the entries that read the
+ * result. A further bitmap per function unit class lets select pick the
+ * oldest ready entry of each class. Every entry is stamped with the cycle
+ * it was dispatched in, which gives the age order. The slot arrays are
+ * sized at init, up to IQ_MAX_SIZE entries. A mask is a fixed array of
+ * 64-bit words, and only the words that cover the configured size are
+ * ever looked at, so a small queue pays for one word and a 256-entry one
+ * for four.
+ */
+#ifndef _ISSUEQUEUE_H_
+#define _ISSUEQUEUE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_stage.h"
+
+#define IQ_MAX_SRCS 3
+#define IQ_MAX_SIZE 256
+#define IQ_MASK_WORDS (IQ_MAX_SIZE / 64)
+
+/* Function unit classes, each one can take one instruction per cycle */
+#define IQ_CLASS_MEM 0 /* LOAD, STORE and friends: address generation for the LSQ */
+#define IQ_CLASS_INT 1
+#define IQ_CLASS_MUL 2
+#define IQ_CLASS_JBU 3
+#define IQ_NUM_CLASSES 4
+
+/* One bit per slot */
+typedef struct iq_mask
+{
+    uint64_t w[IQ_MASK_WORDS];
+} iq_mask;
+
+typedef struct issue_queue
+{
+    CPU_Stage *entry;
+    int (*src_tag)[IQ_MAX_SRCS]; /* Distinct physical tags waited on at dispatch */
+    int *src_count;
+    int *pending;                /* Of those, tags not broadcast yet */
+    uint64_t *age;               /* Dispatch cycle, lower is older */
+    iq_mask *consumers;          /* Per physical tag, the slots waiting on it */
+    iq_mask class_mask[IQ_NUM_CLASSES];
+    iq_mask free_mask;
+    iq_mask valid_mask;
+    iq_mask ready_mask;
+    int size;
+    int words; /* Mask words covering size slots */
+    int count;
+} issue_queue;
+
+static inline void
+iq_mask_set(iq_mask *m, int slot)
+{
+    m->w[slot / 64] |= 1ULL << (slot % 64);
+}
+
+static inline void
+iq_mask_clear(iq_mask *m, int slot)
+{
+    m->w[slot / 64] &= ~(1ULL << (slot % 64));
+}
+
+static inline int
+iq_mask_test(const iq_mask *m, int slot)
+{
+    return (m->w[slot / 64] >> (slot % 64)) & 1;
+}
+
+/* a & b over the queue's words */
+static inline iq_mask
+iq_mask_and(const issue_queue *q, const iq_mask *a, const iq_mask *b)
+{
+    iq_mask m;
+    int i;
+
+    for (i = 0; i < q->words; i++)
+    {
+        m.w[i] = a->w[i] & b->w[i];
+    }
+    return m;
+}
+
+/* Lowest slot at or after from that is set in the mask, or -1 */
+static inline int
+iq_next_slot(const issue_queue *q, const iq_mask *m, int from)
+{
+    int i = from / 64;
+    uint64_t word;
+
+    if (i >= q->words)
+    {
+        return -1;
+    }
+    word = m->w[i] & (~0ULL << (from % 64));
+    while (!word)
+    {
+        if (++i == q->words)
+        {
+            return -1;
+        }
+        word = m->w[i];
+    }
+    return i * 64 + __builtin_ctzll(word);
+}
+
+/*
+ * Allocates an empty queue of size slots for tags 0 .. num_tags - 1,
+ * FALSE if out of memory
+ */
+static inline int
+iq_init(issue_queue *q, int size, int num_tags)
+{
+    int i;
+
+    q->entry = calloc(size, sizeof(CPU_Stage));
+    q->src_tag = calloc(size, sizeof(*q->src_tag));
+    q->src_count = calloc(size, sizeof(int));
+    q->pending = calloc(size, sizeof(int));
+    q->age = calloc(size, sizeof(uint64_t));
+    q->consumers = calloc(num_tags, sizeof(iq_mask));
+    memset(q->class_mask, 0, sizeof(q->class_mask));
+    memset(&q->free_mask, 0, sizeof(q->free_mask));
+    memset(&q->valid_mask, 0, sizeof(q->valid_mask));
+    memset(&q->ready_mask, 0, sizeof(q->ready_mask));
+    for (i = 0; i < size; i++)
+    {
+        iq_mask_set(&q->free_mask, i);
+    }
+    q->size = size;
+    q->words = (size + 63) / 64;
+    q->count = 0;
+    return q->entry && q->src_tag && q->src_count && q->pending && q->age && q->consumers;
+}
+
+static inline void
+iq_destroy(issue_queue *q)
+{
+    free(q->entry);
+    free(q->src_tag);
+    free(q->src_count);
+    free(q->pending);
+    free(q->age);
+    free(q->consumers);
+}
+
+/* Function unit class an instruction is selected in */
+static inline int
+iq_fu_class(int opcode)
+{
+    switch (opcode)
+    {
+    case OPCODE_LOAD:
+    case OPCODE_LDR:
+    case OPCODE_STORE:
+    case OPCODE_STR:
+        return IQ_CLASS_MEM;
+    case OPCODE_MUL:
+        return IQ_CLASS_MUL;
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    case OPCODE_JUMP:
+    case OPCODE_JAL:
+        return IQ_CLASS_JBU;
+    default:
+        return IQ_CLASS_INT;
+    }
+}
+
+/* Physical tags an instruction has to wait for before it can issue */
+static inline int
+iq_source_tags(const CPU_Stage *stage, int tags[IQ_MAX_SRCS])
+{
+    switch (stage->opcode)
+    {
+    case OPCODE_STR:
+    {
+        tags[0] = stage->ps1;
+        tags[1] = stage->ps2;
+        tags[2] = stage->pd;
+        return 3;
+    }
+
+    case OPCODE_STORE:
+    case OPCODE_LDR:
+    case OPCODE_CMP:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    {
+        tags[0] = stage->ps1;
+        tags[1] = stage->ps2;
+        return 2;
+    }
+
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_JUMP:
+    case OPCODE_JAL:
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    {
+        /* BZ and BNZ wait on the physical Z flag */
+        tags[0] = stage->ps1;
+        return 1;
+    }
+
+    default:
+    {
+        return 0;
+    }
+    }
+}
+
+/*
+ * Places an instruction, dispatched in the given cycle, in the lowest free
+ * slot. Sources whose tag is already valid in the PRF are not waited on,
+ * the others register the slot as a consumer of their tag. Returns the
+ * slot, or -1 when the queue is full.
+ */
+static inline int
+iq_dispatch(issue_queue *q, const CPU_Stage *stage, const int *pregs_valid, uint64_t cycle)
+{
+    int tags[IQ_MAX_SRCS];
+    int i, n;
+    int slot = iq_next_slot(q, &q->free_mask, 0);
+
+    if (slot < 0)
+    {
+        return -1;
+    }
+
+    q->entry[slot] = *stage;
+    q->age[slot] = cycle;
+    q->src_count[slot] = 0;
+
+    n = iq_source_tags(stage, tags);
+    for (i = 0; i < n; i++)
+    {
+        if (!pregs_valid[tags[i]] && !iq_mask_test(&q->consumers[tags[i]], slot))
+        {
+            iq_mask_set(&q->consumers[tags[i]], slot);
+            q->src_tag[slot][q->src_count[slot]++] = tags[i];
+        }
+    }
+    q->pending[slot] = q->src_count[slot];
+
+    iq_mask_clear(&q->free_mask, slot);
+    iq_mask_set(&q->valid_mask, slot);
+    iq_mask_set(&q->class_mask[iq_fu_class(stage->opcode)], slot);
+    if (q->pending[slot] == 0)
+    {
+        iq_mask_set(&q->ready_mask, slot);
+    }
+    q->count++;
+    return slot;
+}
+
+/* Tag broadcast: every consumer of the tag has one source fewer to wait for */
+static inline void
+iq_wakeup(issue_queue *q, int tag)
+{
+    iq_mask *waiting = &q->consumers[tag];
+    int i;
+
+    for (i = 0; i < q->words; i++)
+    {
+        while (waiting->w[i])
+        {
+            int slot = i * 64 + __builtin_ctzll(waiting->w[i]);
+
+            waiting->w[i] &= waiting->w[i] - 1;
+            if (--q->pending[slot] == 0)
+            {
+                iq_mask_set(&q->ready_mask, slot);
+            }
+        }
+    }
+}
+
+/* Oldest slot in the given mask, or -1 if the mask is empty */
+static inline int
+iq_oldest(const issue_queue *q, const iq_mask *mask)
+{
+    int best = -1;
+    int slot;
+
+    for (slot = iq_next_slot(q, mask, 0); slot >= 0; slot = iq_next_slot(q, mask, slot + 1))
+    {
+        if (best < 0 || q->age[slot] < q->age[best])
+        {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+/* Frees a slot, which also stops it listening for the tags it waits on */
+static inline void
+iq_remove(issue_queue *q, int slot)
+{
+    int c, i;
+
+    for (i = 0; i < q->src_count[slot]; i++)
+    {
+        iq_mask_clear(&q->consumers[q->src_tag[slot][i]], slot);
+    }
+    for (c = 0; c < IQ_NUM_CLASSES; c++)
+    {
+        iq_mask_clear(&q->class_mask[c], slot);
+    }
+    iq_mask_clear(&q->valid_mask, slot);
+    iq_mask_clear(&q->ready_mask, slot);
+    iq_mask_set(&q->free_mask, slot);
+    q->count--;
+}
+
+static inline void
+iq_flush(issue_queue *q)
+{
+    int slot;
+
+    while ((slot = iq_next_slot(q, &q->valid_mask, 0)) >= 0)
+    {
+        iq_remove(q, slot);
+    }
+}
+
+#endif
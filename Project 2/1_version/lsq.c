@@ -0,0 +1,109 @@
+/*
+ * lsq.c
+ * Load selection, store-to-load forwarding and violation detection
+ */
+#include "lsq.h"
+
+const char *const lsq_mode_names[NUM_LSQ_MODES] = {"ooo", "head", "storeset"};
+
+/* An older store of the load's set, k-th in the LSQ, has no address yet */
+static int
+waits_for_store_set(load_store_queue *q, int k)
+{
+    int ssid = lsq_at(q, k)->ssid;
+    int j;
+
+    if (ssid == SSID_NONE)
+    {
+        return FALSE;
+    }
+    for (j = 0; j < k; j++)
+    {
+        const lsq_entry *older = lsq_at(q, j);
+
+        if (older->is_store && !older->addr_valid && older->ssid == ssid)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Oldest load that has its address and has not been issued, or LSQ_NONE.
+ * Without speculate it must also have no older store with an unknown
+ * address; with it, only older stores of its store set hold it back. The
+ * chosen load is marked issued, and forwarded from the youngest older
+ * store with a known address that writes the same word, if there is one.
+ */
+int
+lsq_select_load(load_store_queue *q, int speculate)
+{
+    int k, j;
+
+    for (k = 0; k < q->count; k++)
+    {
+        lsq_entry *e = lsq_at(q, k);
+
+        if (e->is_store)
+        {
+            if (!e->addr_valid && !speculate)
+            {
+                return LSQ_NONE;
+            }
+            continue;
+        }
+        if (!e->addr_valid || e->issued || (speculate && waits_for_store_set(q, k)))
+        {
+            continue;
+        }
+
+        e->issued = TRUE;
+        e->forwarded = FALSE;
+        for (j = k - 1; j >= 0; j--)
+        {
+            const lsq_entry *older = lsq_at(q, j);
+
+            if (older->is_store && older->addr_valid && older->addr == e->addr)
+            {
+                e->forwarded = TRUE;
+                e->data = older->data;
+                break;
+            }
+        }
+        return (q->head + k) % q->size;
+    }
+    return LSQ_NONE;
+}
+
+/*
+ * The store in slot store has just got its address. Returns the oldest
+ * younger load to that address that already issued without seeing it, or
+ * LSQ_NONE. A younger store to the same address in between shields the
+ * loads after it: they took its data, or a still younger store's.
+ */
+int
+lsq_find_violation(load_store_queue *q, int store)
+{
+    int addr = q->entry[store].addr;
+    int k;
+
+    for (k = lsq_age(q, store) + 1; k < q->count; k++)
+    {
+        const lsq_entry *e = lsq_at(q, k);
+
+        if (!e->addr_valid || e->addr != addr)
+        {
+            continue;
+        }
+        if (e->is_store)
+        {
+            return LSQ_NONE;
+        }
+        if (e->issued)
+        {
+            return (q->head + k) % q->size;
+        }
+    }
+    return LSQ_NONE;
+}
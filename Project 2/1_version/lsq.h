@@ -0,0 +1,153 @@
+/*
+ * lsq.h
+ * Load/store queue between dispatch and the memory unit
+ *
+ * Every LOAD, LDR, STORE and STR takes an entry at dispatch, in program
+ * order, and gives it back when it commits. The address, and for a store
+ * the data, is filled in once the op's register operands are read, at
+ * dispatch or when it leaves the IQ. Stores write data memory at commit.
+ *
+ * In LSQ_MODE_OOO a load is sent to the memory unit as soon as every older
+ * store has a known address (lsq_select_load). If one of them writes the
+ * same word, the youngest such store forwards its data and memory is not
+ * read. LSQ_MODE_STORE_SET only holds a load for older stores of its store
+ * set (storeset.h) and lets it pass the others. A store that then resolves
+ * to the address of a younger load that has already issued is a memory
+ * order violation (lsq_find_violation), and the load is replayed.
+ * LSQ_MODE_HEAD keeps the spec's ordering: memory ops only leave from the
+ * ROB head.
+ */
+#ifndef _LSQ_H_
+#define _LSQ_H_
+
+#include <stdlib.h>
+#include "apex_macros.h"
+#include "storeset.h"
+
+/* Load issue policies, selected with the "lsq_mode" config key */
+#define LSQ_MODE_OOO 0       /* Loads issue once older store addresses are known */
+#define LSQ_MODE_HEAD 1      /* Loads and stores issue from the ROB head, as in the spec */
+#define LSQ_MODE_STORE_SET 2 /* Loads only wait for older stores in their store set */
+#define NUM_LSQ_MODES 3
+
+#define LSQ_NONE -1
+
+typedef struct lsq_entry
+{
+    int rob_id;
+    int pc;
+    int ssid; /* Store set, or SSID_NONE */
+    int is_store;
+    int addr_valid;
+    int addr;
+    int data;      /* Store data, or the value forwarded to a load */
+    int issued;    /* Sent to the memory unit */
+    int forwarded; /* Load takes data instead of reading memory */
+    int done;      /* Store went through M1 and may commit */
+} lsq_entry;
+
+typedef struct load_store_queue
+{
+    lsq_entry *entry;
+    int size;
+    int head; /* Oldest memory op */
+    int tail; /* Slot the next dispatched op will take */
+    int count;
+} load_store_queue;
+
+extern const char *const lsq_mode_names[NUM_LSQ_MODES];
+
+int lsq_select_load(load_store_queue *q, int speculate);
+int lsq_find_violation(load_store_queue *q, int store);
+
+/* Allocates an empty LSQ of size entries, FALSE if out of memory */
+static inline int
+lsq_init(load_store_queue *q, int size)
+{
+    q->entry = calloc(size, sizeof(lsq_entry));
+    q->size = size;
+    q->head = 0;
+    q->tail = 0;
+    q->count = 0;
+    return q->entry != NULL;
+}
+
+static inline void
+lsq_destroy(load_store_queue *q)
+{
+    free(q->entry);
+}
+
+static inline int
+lsq_full(const load_store_queue *q)
+{
+    return q->count == q->size;
+}
+
+/* Appends a memory op at the tail and returns its slot */
+static inline int
+lsq_push(load_store_queue *q, int rob_id, int pc, int is_store, int ssid)
+{
+    int id = q->tail;
+    lsq_entry *e = &q->entry[id];
+
+    e->rob_id = rob_id;
+    e->pc = pc;
+    e->ssid = ssid;
+    e->is_store = is_store;
+    e->addr_valid = FALSE;
+    e->issued = FALSE;
+    e->forwarded = FALSE;
+    e->done = FALSE;
+    q->tail = (q->tail + 1) % q->size;
+    q->count++;
+    return id;
+}
+
+/* Word address inside data memory */
+static inline int
+data_address_valid(int addr)
+{
+    return addr >= 0 && addr < DATA_MEMORY_SIZE;
+}
+
+/* Address and store data are known */
+static inline void
+lsq_set_address(load_store_queue *q, int id, int addr, int data)
+{
+    q->entry[id].addr = addr;
+    q->entry[id].data = data;
+    q->entry[id].addr_valid = TRUE;
+}
+
+/* k-th entry counting from the head (k = 0 is the oldest) */
+static inline lsq_entry *
+lsq_at(load_store_queue *q, int k)
+{
+    return &q->entry[(q->head + k) % q->size];
+}
+
+/* Position of a slot counting from the head */
+static inline int
+lsq_age(const load_store_queue *q, int id)
+{
+    return (id - q->head + q->size) % q->size;
+}
+
+/* Retires the oldest memory op */
+static inline void
+lsq_pop(load_store_queue *q)
+{
+    q->head = (q->head + 1) % q->size;
+    q->count--;
+}
+
+/* Drops the youngest memory op */
+static inline void
+lsq_pop_tail(load_store_queue *q)
+{
+    q->tail = (q->tail + q->size - 1) % q->size;
+    q->count--;
+}
+
+#endif
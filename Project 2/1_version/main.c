@@ -7,26 +7,229 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "apex_cpu.h"
+#include "apex_trace.h"
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr,
+            "APEX_Help: Usage %s [--run-to-halt] [--quiet] [--max-cycles <n>] [--no-fast-forward]\n"
+            "           [--trace off|commit|stage|full] [--trace-stages <s1,s2,..>]\n"
+            "           [--event-trace <trace_file>] [--config <config_file>] [--set <key>=<value>]\n"
+            "           [--skip <n>] [--skip-to <pc>] <input_file>\n"
+            "           stages: fetch decode iq intfu mulfu jbu1 jbu2 mem1 mem2 rob\n"
+            "           keys: iq_size rob_size pregs mul_latency mem_depth predictor lsq_size\n"
+            "                 lsq_mode\n"
+            "           predictors: last bimodal gshare tournament\n"
+            "           lsq modes: ooo head storeset\n",
+            prog);
+}
+
+static const char *trace_level_names[] = {"off", "commit", "stage", "full"};
+
+static const char *stage_names[NUM_STAGES] = {
+    "fetch", "decode", "iq", "intfu", "mulfu",
+    "jbu1", "jbu2", "mem1", "mem2", "rob"};
+
+/* Returns the TRACE_* level for a name, or -1 */
+static int
+parse_trace_level(const char *name)
+{
+    int i;
+
+    for (i = TRACE_OFF; i <= TRACE_FULL; i++)
+    {
+        if (strcmp(name, trace_level_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Comma separated stage names to a trace_stages mask, 0 on a bad name */
+static unsigned int
+parse_stage_mask(const char *list)
+{
+    char buffer[128];
+    unsigned int mask = 0;
+    char *token;
+    int i;
+
+    strncpy(buffer, list, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    for (token = strtok(buffer, ","); token != NULL; token = strtok(NULL, ","))
+    {
+        for (i = 0; i < NUM_STAGES; i++)
+        {
+            if (strcmp(token, stage_names[i]) == 0)
+            {
+                break;
+            }
+        }
+        if (i == NUM_STAGES)
+        {
+            return 0;
+        }
+        mask |= 1u << i;
+    }
+    return mask;
+}
 
 int main(int argc, char const *argv[])
 {
     APEX_CPU *cpu;
+    const char *filename = NULL;
+    const char *event_trace = NULL;
+    const char *bad_key;
+    APEX_Config config;
+    int run_to_halt = FALSE;
+    int fast_forward = TRUE; /* Only used by --run-to-halt */
+    int trace_level = APEX_TRACE_MAX;
+    unsigned int trace_stages = TRACE_ALL_STAGES;
+    long max_cycles = 0;
+    long skip = 0;    /* Instructions run functionally before the detailed core starts */
+    int skip_to = -1; /* Or the PC to run functionally up to */
+    int i;
 
-    fprintf(stderr, "APEX CPU Pipeline Simulator\n");
+    /* The config file is applied first so --set always overrides it */
+    APEX_config_default(&config);
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "--config") == 0 && !APEX_config_load(&config, argv[i + 1]))
+        {
+            exit(1);
+        }
+    }
 
-    if (argc != 2)
+    for (i = 1; i < argc; i++)
     {
-        fprintf(stderr, "APEX_Help: Usage %s <input_file>\n", argv[0]);
+        if (strcmp(argv[i], "--run-to-halt") == 0)
+        {
+            run_to_halt = TRUE;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            trace_level = TRACE_OFF;
+        }
+        else if (strcmp(argv[i], "--no-fast-forward") == 0)
+        {
+            fast_forward = FALSE;
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            max_cycles = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc &&
+                 (trace_level = parse_trace_level(argv[i + 1])) >= 0)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--trace-stages") == 0 && i + 1 < argc &&
+                 (trace_stages = parse_stage_mask(argv[i + 1])) != 0)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc &&
+                 APEX_config_set(&config, argv[i + 1]))
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+        {
+            skip = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--skip-to") == 0 && i + 1 < argc)
+        {
+            skip_to = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--event-trace") == 0 && i + 1 < argc)
+        {
+            event_trace = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !filename)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (trace_level > APEX_TRACE_MAX)
+    {
+        fprintf(stderr, "APEX_Warning: trace level limited to %s in this build\n",
+                trace_level_names[APEX_TRACE_MAX]);
+        trace_level = APEX_TRACE_MAX;
+    }
+
+    if (trace_level != TRACE_OFF)
+    {
+        fprintf(stderr, "APEX CPU Pipeline Simulator\n");
+    }
+
+    if (!filename)
+    {
+        print_usage(argv[0]);
         exit(1);
     }
 
-    cpu = APEX_cpu_init(argv[1]);
+    bad_key = APEX_config_check(&config);
+    if (bad_key)
+    {
+        fprintf(stderr, "APEX_Error: %s is out of range\n", bad_key);
+        exit(1);
+    }
+
+    cpu = APEX_cpu_init(filename, &config);
     if (!cpu)
     {
         fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
         exit(1);
     }
+    cpu->trace_level = trace_level;
+    cpu->trace_stages = trace_stages;
+    if (skip > 0 || skip_to >= 0)
+    {
+        APEX_func_run(cpu, skip, skip_to);
+        if (!APEX_cpu_enter_detailed(cpu))
+        {
+            fprintf(stderr, "APEX_Error: Not enough physical registers to resume at pc(%d)\n",
+                    cpu->pc);
+            exit(1);
+        }
+    }
+    if (event_trace)
+    {
+        cpu->event_trace = apex_trace_open(event_trace, cpu);
+        if (!cpu->event_trace)
+        {
+            fprintf(stderr, "APEX_Error: Unable to create %s\n", event_trace);
+            exit(1);
+        }
+    }
+    if (TRACE_ON(cpu, TRACE_FULL))
+    {
+        APEX_print_code_memory(cpu);
+    }
+
+    if (run_to_halt)
+    {
+        int status = APEX_cpu_run_to_halt(cpu, max_cycles, fast_forward);
+
+        APEX_print_summary(cpu);
+        APEX_cpu_stop(cpu);
+        return status;
+    }
+
     int x, y;
     while (1)
     {
@@ -71,6 +274,7 @@ int main(int argc, char const *argv[])
         default:
         {
             printf("\nExit : ");
+            APEX_cpu_stop(cpu);
             return 0;
         }
         }
@@ -0,0 +1,112 @@
+/*
+ * predictor.c
+ * Last-outcome, bimodal, gshare and tournament direction predictors
+ */
+#include <string.h>
+#include "predictor.h"
+
+const char *const predictor_names[NUM_PREDICTORS] = {"last", "bimodal", "gshare",
+                                                     "tournament"};
+
+static int
+pc_index(int pc)
+{
+    return (pc >> 2) & (PREDICTOR_TABLE_SIZE - 1);
+}
+
+static int
+gshare_index(int pc, unsigned int history)
+{
+    return (pc_index(pc) ^ history) & (PREDICTOR_TABLE_SIZE - 1);
+}
+
+/* Saturating 2-bit counter, 2 and 3 predict taken */
+static void
+counter_train(uint8_t *counter, int taken)
+{
+    if (taken && *counter < 3)
+    {
+        (*counter)++;
+    }
+    else if (!taken && *counter > 0)
+    {
+        (*counter)--;
+    }
+}
+
+static int
+last_predict(const branch_predictor *p, int pc)
+{
+    return p->last[pc_index(pc)];
+}
+
+static void
+last_update(branch_predictor *p, int pc, unsigned int history, int taken)
+{
+    p->last[pc_index(pc)] = taken != 0;
+}
+
+static int
+bimodal_predict(const branch_predictor *p, int pc)
+{
+    return p->bimodal[pc_index(pc)] >= 2;
+}
+
+static void
+bimodal_update(branch_predictor *p, int pc, unsigned int history, int taken)
+{
+    counter_train(&p->bimodal[pc_index(pc)], taken);
+}
+
+static int
+gshare_predict(const branch_predictor *p, int pc)
+{
+    return p->gshare[gshare_index(pc, p->history)] >= 2;
+}
+
+static void
+gshare_update(branch_predictor *p, int pc, unsigned int history, int taken)
+{
+    counter_train(&p->gshare[gshare_index(pc, history)], taken);
+}
+
+static int
+tournament_predict(const branch_predictor *p, int pc)
+{
+    return p->chooser[pc_index(pc)] >= 2 ? gshare_predict(p, pc) : bimodal_predict(p, pc);
+}
+
+/* The chooser only moves when exactly one of the two components was right */
+static void
+tournament_update(branch_predictor *p, int pc, unsigned int history, int taken)
+{
+    int bimodal_right = (p->bimodal[pc_index(pc)] >= 2) == (taken != 0);
+    int gshare_right = (p->gshare[gshare_index(pc, history)] >= 2) == (taken != 0);
+
+    if (bimodal_right != gshare_right)
+    {
+        counter_train(&p->chooser[pc_index(pc)], gshare_right);
+    }
+    bimodal_update(p, pc, history, taken);
+    gshare_update(p, pc, history, taken);
+}
+
+static const predictor_ops predictor_table[NUM_PREDICTORS] = {
+    {last_predict, last_update},
+    {bimodal_predict, bimodal_update},
+    {gshare_predict, gshare_update},
+    {tournament_predict, tournament_update},
+};
+
+/* Empty history, counters weakly not taken, chooser weakly bimodal */
+void
+predictor_init(branch_predictor *p, int kind)
+{
+    p->ops = &predictor_table[kind];
+    p->kind = kind;
+    p->history = 0;
+    memset(p->last, 0, sizeof(p->last));
+    memset(p->bimodal, 1, sizeof(p->bimodal));
+    memset(p->gshare, 1, sizeof(p->gshare));
+    memset(p->chooser, 1, sizeof(p->chooser));
+}
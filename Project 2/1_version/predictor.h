@@ -0,0 +1,87 @@
+/*
+ * predictor.h
+ * Branch direction predictors consulted by the fetch stage
+ *
+ * Every predictor implements predict and update behind a predictor_ops
+ * table, and all of them share one global history register. Fetch asks
+ * for a direction on every BZ and BNZ, stores the history it saw in the
+ * instruction (predictor_checkpoint) and shifts the predicted outcome in
+ * (predictor_speculate). A squash puts the history back to the snapshot
+ * of the branch that recovers (predictor_restore), and update trains the
+ * tables when a branch resolves in JBU1. A branch predicted taken still
+ * needs a BTB entry for its target, see btb.h.
+ */
+#ifndef _PREDICTOR_H_
+#define _PREDICTOR_H_
+
+#include <stdint.h>
+
+/* Predictor kinds, selected with the "predictor" config key */
+#define PREDICTOR_LAST 0       /* Outcome of the branch's last execution, as in the spec */
+#define PREDICTOR_BIMODAL 1    /* 2-bit counters indexed by PC */
+#define PREDICTOR_GSHARE 2     /* 2-bit counters indexed by PC xor global history */
+#define PREDICTOR_TOURNAMENT 3 /* Bimodal or gshare, picked by a per-PC 2-bit chooser */
+#define NUM_PREDICTORS 4
+
+/* Entries per table, and bits of global history folded into the gshare index */
+#define PREDICTOR_INDEX_BITS 10
+#define PREDICTOR_TABLE_SIZE (1 << PREDICTOR_INDEX_BITS)
+
+typedef struct branch_predictor branch_predictor;
+
+typedef struct predictor_ops
+{
+    int (*predict)(const branch_predictor *p, int pc);
+    /* history is the snapshot the branch was predicted with */
+    void (*update)(branch_predictor *p, int pc, unsigned int history, int taken);
+} predictor_ops;
+
+struct branch_predictor
+{
+    const predictor_ops *ops;
+    int kind;
+    unsigned int history; /* Speculative global history, newest outcome in bit 0 */
+    uint8_t last[PREDICTOR_TABLE_SIZE];
+    uint8_t bimodal[PREDICTOR_TABLE_SIZE];
+    uint8_t gshare[PREDICTOR_TABLE_SIZE];
+    uint8_t chooser[PREDICTOR_TABLE_SIZE]; /* 2 and above selects gshare */
+};
+
+extern const char *const predictor_names[NUM_PREDICTORS];
+
+void predictor_init(branch_predictor *p, int kind);
+
+static inline int
+predictor_predict(const branch_predictor *p, int pc)
+{
+    return p->ops->predict(p, pc);
+}
+
+static inline void
+predictor_update(branch_predictor *p, int pc, unsigned int history, int taken)
+{
+    p->ops->update(p, pc, history, taken);
+}
+
+/* History seen by the instruction being fetched */
+static inline unsigned int
+predictor_checkpoint(const branch_predictor *p)
+{
+    return p->history;
+}
+
+/* Shifts the direction fetch follows for a branch into the history */
+static inline void
+predictor_speculate(branch_predictor *p, int taken)
+{
+    p->history = (p->history << 1) | (taken != 0);
+}
+
+/* Drops the history of every instruction fetched after the snapshot */
+static inline void
+predictor_restore(branch_predictor *p, unsigned int snapshot)
+{
+    p->history = snapshot;
+}
+
+#endif
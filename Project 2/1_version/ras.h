@@ -0,0 +1,80 @@
+/*
+ * ras.h
+ * Return address stack used by the fetch stage
+ *
+ * A fetched JAL pushes its return address and a fetched return, a JUMP
+ * with a zero offset, pops the address it predicts. The stack is a ring:
+ * a push onto a full stack overwrites the oldest entry, and a pop of an
+ * empty stack predicts nothing. Every fetched instruction keeps a
+ * checkpoint of the top pointer, the depth and the top entry, which is
+ * enough to undo the pushes and pops of the wrong path after a squash.
+ */
+#ifndef _RAS_H_
+#define _RAS_H_
+
+#define RAS_SIZE 8
+
+typedef struct return_stack
+{
+    int entry[RAS_SIZE];
+    int top;   /* Slot of the newest return address */
+    int count; /* Valid entries, at most RAS_SIZE */
+} return_stack;
+
+typedef struct ras_checkpoint
+{
+    int top;
+    int count;
+    int value; /* Entry under top when the checkpoint was taken */
+} ras_checkpoint;
+
+static inline int
+ras_empty(const return_stack *r)
+{
+    return r->count == 0;
+}
+
+static inline int
+ras_peek(const return_stack *r)
+{
+    return r->entry[r->top];
+}
+
+static inline void
+ras_push(return_stack *r, int addr)
+{
+    r->top = (r->top + 1) % RAS_SIZE;
+    r->entry[r->top] = addr;
+    if (r->count < RAS_SIZE)
+    {
+        r->count++;
+    }
+}
+
+static inline void
+ras_pop(return_stack *r)
+{
+    if (r->count > 0)
+    {
+        r->top = (r->top + RAS_SIZE - 1) % RAS_SIZE;
+        r->count--;
+    }
+}
+
+static inline ras_checkpoint
+ras_save(const return_stack *r)
+{
+    ras_checkpoint c = {r->top, r->count, r->entry[r->top]};
+
+    return c;
+}
+
+static inline void
+ras_restore(return_stack *r, const ras_checkpoint *c)
+{
+    r->top = c->top;
+    r->count = c->count;
+    r->entry[r->top] = c->value;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * renametable.h
+ * Direct-mapped rename table with branch checkpoints
+ *
+ * map[] holds the newest physical register for every architectural
+ * register, so a source lookup is a single array read. The Z flag is
+ * renamed like a register, through the extra RAT_FLAG entry. A branch takes a
+ * checkpoint slot when it is dispatched; restoring the slot puts the
+ * mapping back to what it was at that point. The slot number doubles as
+ * the branch's tag, and used_mask is the set of unresolved branches.
+ */
+#ifndef _RENAMETABLE_H_
+#define _RENAMETABLE_H_
+
+#include <string.h>
+#include "apex_stage.h"
+
+#define RAT_NO_CHECKPOINT -1
+
+/* Rename table entry of the Z flag, after the integer registers */
+#define RAT_FLAG REG_FILE_SIZE
+#define RAT_ENTRIES (REG_FILE_SIZE + 1)
+
+typedef struct rename_table
+{
+    int map[RAT_ENTRIES]; /* -1 until the register is first renamed */
+    int saved[MAX_BRANCH_CHECKPOINTS][RAT_ENTRIES];
+    unsigned int used_mask; /* Checkpoint slots held by in-flight branches */
+    int unmapped;           /* Tag read by registers that were never renamed */
+} rename_table;
+
+static inline void
+rat_init(rename_table *t, int unmapped)
+{
+    int i;
+
+    for (i = 0; i < RAT_ENTRIES; i++)
+    {
+        t->map[i] = -1;
+    }
+    t->used_mask = 0;
+    t->unmapped = unmapped;
+}
+
+/* Physical register, or -1 if the architectural register was never renamed */
+static inline int
+rat_mapping(const rename_table *t, int arch)
+{
+    return t->map[arch];
+}
+
+/*
+ * Source operand lookup. An architectural register that was never renamed
+ * reads the extra slot past the last physical register.
+ */
+static inline int
+rat_lookup(const rename_table *t, int arch)
+{
+    return t->map[arch] < 0 ? t->unmapped : t->map[arch];
+}
+
+/* Points arch at a new physical register, returns the previous mapping */
+static inline int
+rat_rename(rename_table *t, int arch, int phys)
+{
+    int prev = t->map[arch];
+
+    t->map[arch] = phys;
+    return prev;
+}
+
+/* Snapshots the table, returns the slot or RAT_NO_CHECKPOINT if all are taken */
+static inline int
+rat_checkpoint(rename_table *t)
+{
+    unsigned int free_slots = ~t->used_mask & ((1u << MAX_BRANCH_CHECKPOINTS) - 1);
+    int slot;
+
+    if (free_slots == 0)
+    {
+        return RAT_NO_CHECKPOINT;
+    }
+
+    slot = __builtin_ctz(free_slots);
+    memcpy(t->saved[slot], t->map, sizeof(t->map));
+    t->used_mask |= 1u << slot;
+    return slot;
+}
+
+static inline int
+rat_checkpoint_available(const rename_table *t)
+{
+    return t->used_mask != (1u << MAX_BRANCH_CHECKPOINTS) - 1;
+}
+
+static inline void
+rat_release(rename_table *t, int slot)
+{
+    if (slot != RAT_NO_CHECKPOINT)
+    {
+        t->used_mask &= ~(1u << slot);
+    }
+}
+
+/* Frees every slot not in keep, whose branches were squashed */
+static inline void
+rat_retain(rename_table *t, unsigned int keep)
+{
+    t->used_mask &= keep;
+}
+
+/* Rolls the mapping back to the snapshot and frees the slot */
+static inline void
+rat_restore(rename_table *t, int slot)
+{
+    memcpy(t->map, t->saved[slot], sizeof(t->map));
+    rat_release(t, slot);
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * reorderbuffer.h
+ * Circular reorder buffer used by the ROB stage
+ *
+ * Entries are kept in a ring indexed by ROB ID. Head and tail are plain
+ * indices and an occupancy counter tracks fullness, so dispatch, commit,
+ * squash and indexed inspection never walk a list or allocate memory.
+ * The ring is allocated once, at init.
+ */
+#ifndef _REORDERBUFFER_H_
+#define _REORDERBUFFER_H_
+
+#include <stdlib.h>
+#include "apex_stage.h"
+
+typedef struct reorder_buffer
+{
+    CPU_Stage *entry;
+    int size;
+    int head;  /* ROB ID of the oldest entry */
+    int tail;  /* ROB ID the next dispatched entry will take */
+    int count;
+} reorder_buffer;
+
+/* Allocates an empty ROB of size entries, FALSE if out of memory */
+static inline int
+rob_init(reorder_buffer *r, int size)
+{
+    r->entry = calloc(size, sizeof(CPU_Stage));
+    r->size = size;
+    r->head = 0;
+    r->tail = 0;
+    r->count = 0;
+    return r->entry != NULL;
+}
+
+static inline void
+rob_destroy(reorder_buffer *r)
+{
+    free(r->entry);
+}
+
+/* Appends an entry at the tail, returns its ROB ID or -1 when full */
+static inline int
+rob_push(reorder_buffer *r, const CPU_Stage *stage)
+{
+    int id;
+
+    if (r->count == r->size)
+    {
+        return -1;
+    }
+
+    id = r->tail;
+    r->entry[id] = *stage;
+    r->entry[id].rob_id = id;
+    r->entry[id].mem_issued = FALSE;
+    r->entry[id].branch_done = FALSE;
+    r->tail = (r->tail + 1) % r->size;
+    r->count++;
+    return id;
+}
+
+/* Oldest entry, NULL when the ROB is empty */
+static inline CPU_Stage *
+rob_head(reorder_buffer *r)
+{
+    return r->count ? &r->entry[r->head] : NULL;
+}
+
+/* Retires the entry at the head */
+static inline void
+rob_pop(reorder_buffer *r)
+{
+    if (r->count == 0)
+    {
+        return;
+    }
+
+    r->head = (r->head + 1) % r->size;
+    r->count--;
+}
+
+/* k-th entry counting from the head (k = 0 is the head) */
+static inline CPU_Stage *
+rob_at(reorder_buffer *r, int k)
+{
+    return &r->entry[(r->head + k) % r->size];
+}
+
+/* Drops every entry younger than the given ROB ID */
+static inline void
+rob_squash_after(reorder_buffer *r, int id)
+{
+    int kept = (id - r->head + r->size) % r->size + 1;
+
+    if (kept > r->count)
+    {
+        return;
+    }
+
+    r->tail = (id + 1) % r->size;
+    r->count = kept;
+}
+
+/* Drops the given ROB ID and every entry younger than it */
+static inline void
+rob_squash_from(reorder_buffer *r, int id)
+{
+    int kept = (id - r->head + r->size) % r->size;
+
+    if (kept >= r->count)
+    {
+        return;
+    }
+
+    r->tail = id;
+    r->count = kept;
+}
+
+/* The ROB ID belongs to an instruction still in the ROB */
+static inline int
+rob_contains(const reorder_buffer *r, int id)
+{
+    return (id - r->head + r->size) % r->size < r->count;
+}
+
+static inline void
+rob_flush(reorder_buffer *r)
+{
+    r->head = r->tail;
+    r->count = 0;
+}
+
+#endif
@@ -1,202 +0,0 @@
-
-#include "registerrenaming.h"
-
-typedef struct node
-{
-    CPU_Stage data;
-    struct node* next;
-} node;
-
-
-node *iqhead ;
-node *robhead;
-node* tmp;
-typedef void (*callback)(node* data);
-
-node* create(CPU_Stage data,node* next)
-{
-    node* new_node = (node*)malloc(sizeof(node));
-    if(new_node == NULL)
-    {
-        printf("Error creating a new node.\n");
-        exit(0);
-    }
-    new_node->data = data;
-    new_node->next = next;
-
-    return new_node;
-}
-
-node* prepend(node* head,CPU_Stage data)
-{
-    node* new_node = create(data,head);
-    head = new_node;
-    return head;
-}
-
-node* append(node* head, CPU_Stage data)
-{
-    if(head == NULL)
-        return NULL;
-    /* go to the last node */
-    node *cursor = head;
-    while(cursor->next != NULL)
-        cursor = cursor->next;
-
-    /* create a new node */
-    node* new_node =  create(data,NULL);
-    cursor->next = new_node;
-
-    return head;
-}
-
-
-
-node* enqueue(node* head,CPU_Stage data){
-        if(head == NULL){
-            head = prepend(head,data);
-            }
-            else{
-            head = append(head,data);
-            }
-            return head;
-}
-
-void traverse(node* head,callback f)
-{
-    node* cursor = head;
-    while(cursor != NULL)
-    {
-        f(cursor);
-        cursor = cursor->next;
-    }
-}
-
-node* dequeue(node* head)
-{
-    if(head == NULL)
-        return NULL;
-    node *front = head;
-    head = head->next;
-    front->next = NULL;
-    /* is this the last node in the list */
-    if(front == head)
-        head = NULL;
-    free(front);
-    return head;
-}
-
-int count(node *head)
-{
-    node *cursor = head;
-    int c = 0;
-    while(cursor != NULL)
-    {
-        c++;
-        cursor = cursor->next;
-    }
-    return c;
-}
-
-CPU_Stage searchAtIndex(node* head,int index)
-{
-    
-    node *cursor = head;
-    int i=0;
-    while(i!=index)
-    {
-       
-        cursor = cursor->next;
-        i++;
-    }
-    return cursor->data;
-}
-
-node* remove_back(node* head)
-{
-    if(head == NULL)
-        return NULL;
- 
-    node *cursor = head;
-    node *back = NULL;
-    while(cursor->next != NULL)
-    {
-        back = cursor;
-        cursor = cursor->next;
-    }
- 
-    if(back != NULL)
-        back->next = NULL;
- 
-    /* if this is the last node in the list*/
-    if(cursor == head)
-        head = NULL;
- 
-    free(cursor);
- 
-    return head;
-}
-node* remove_front(node* head)
-{
-    if(head == NULL)
-        return NULL;
-    node *front = head;
-    head = head->next;
-    front->next = NULL;
-    /* is this the last node in the list */
-    if(front == head)
-        head = NULL;
-    free(front);
-    return head;
-}
-node* remove_any(node* head,node* nd)
-{
-    if(nd == NULL)
-        return NULL;
-    /* if the node is the first node */
-    if(nd == head)
-        return remove_front(head);
- 
-    /* if the node is the last node */
-    if(nd->next == NULL)
-        return remove_back(head);
- 
-    /* if the node is in the middle */
-    node* cursor = head;
-    while(cursor != NULL)
-    {
-        if(cursor->next == nd)
-            break;
-        cursor = cursor->next;
-    }
- 
-    if(cursor != NULL)
-    {
-        node* tmp = cursor->next;
-        cursor->next = tmp->next;
-        tmp->next = NULL;
-        free(tmp);
-    }
-    return head;
- 
-}
-
-void dispose(node *head)
-{
-    node *cursor, *tmp;
-
-    if(head != NULL)
-    {
-        cursor = head->next;
-        head->next = NULL;
-        while(cursor != NULL)
-        {
-            tmp = cursor->next;
-            free(cursor);
-            cursor = tmp;
-        }
-    }
-}
-
-
-
@@ -0,0 +1,85 @@
+/*
+ * storeset.h
+ * Store-set memory dependence predictor for speculative load issue
+ *
+ * The store set ID table (SSIT) maps a load or store PC to a store set.
+ * It starts empty, so every load is first predicted independent and may
+ * issue ahead of older stores whose addresses are still unknown. When
+ * such a store later resolves to the load's address, the load is replayed
+ * and the two PCs are put in one set (store_set_train). From then on the
+ * load waits for every older in-flight store of its set. The LSQ itself
+ * records each op's set, so it plays the part of the last fetched store
+ * table.
+ */
+#ifndef _STORESET_H_
+#define _STORESET_H_
+
+#include <stdint.h>
+
+#define SSIT_INDEX_BITS 10
+#define SSIT_SIZE (1 << SSIT_INDEX_BITS)
+#define NUM_STORE_SETS 128
+#define SSID_NONE -1
+
+typedef struct store_set_table
+{
+    int16_t ssid[SSIT_SIZE]; /* SSID_NONE, or the set of the PCs mapped here */
+    int next_ssid;           /* Given to the next pair that has no set */
+} store_set_table;
+
+static inline int
+ssit_index(int pc)
+{
+    return (pc >> 2) & (SSIT_SIZE - 1);
+}
+
+static inline void
+store_set_init(store_set_table *t)
+{
+    int i;
+
+    for (i = 0; i < SSIT_SIZE; i++)
+    {
+        t->ssid[i] = SSID_NONE;
+    }
+    t->next_ssid = 0;
+}
+
+/* Store set of the instruction at pc, SSID_NONE if it has none */
+static inline int
+store_set_lookup(const store_set_table *t, int pc)
+{
+    return t->ssid[ssit_index(pc)];
+}
+
+/*
+ * A load at load_pc read memory before an older store at store_pc wrote
+ * the same word. Neither in a set gets a new one, one in a set brings the
+ * other in, and two different sets merge into the lower numbered one.
+ */
+static inline void
+store_set_train(store_set_table *t, int load_pc, int store_pc)
+{
+    int16_t *load = &t->ssid[ssit_index(load_pc)];
+    int16_t *store = &t->ssid[ssit_index(store_pc)];
+
+    if (*load == SSID_NONE && *store == SSID_NONE)
+    {
+        *load = *store = t->next_ssid;
+        t->next_ssid = (t->next_ssid + 1) % NUM_STORE_SETS;
+    }
+    else if (*load == SSID_NONE)
+    {
+        *load = *store;
+    }
+    else if (*store == SSID_NONE || *store > *load)
+    {
+        *store = *load;
+    }
+    else
+    {
+        *load = *store;
+    }
+}
+
+#endif
@@ -0,0 +1,43 @@
+MOVC R1,#3
+MOVC R2,#1
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+MUL R1,R1,R2
+HALT
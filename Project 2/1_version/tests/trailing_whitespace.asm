@@ -0,0 +1,9 @@
+MOVC R1,#4   
+MOVC R2,#6	
+ADD R3,R1,R2 	 
+STORE R3,R1,#0
+LOAD R4,R1,#0          
+CMP R4,R3
+BZ #8                              
+MOVC R5,#1
+HALT 
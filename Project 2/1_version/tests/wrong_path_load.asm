@@ -0,0 +1,14 @@
+MOVC R1,#30000
+ADD R1,R1,R1
+ADD R1,R1,R1
+ADD R1,R1,R1
+ADD R1,R1,R1
+ADD R1,R1,R1
+ADD R1,R1,R1
+ADD R1,R1,R1
+MOVC R2,#2
+MUL R2,R2,R2
+CMP R2,R2
+BZ #8
+LOAD R3,R1,#0
+HALT